@@ -32,6 +32,7 @@ static void declare_basis(nb::module_ &m, std::string const &type_name) {
     pyclass.def("get_kets", &Basis<T>::get_kets)
         .def("get_ket", &Basis<T>::get_ket)
         .def("get_state", &Basis<T>::get_state)
+        .def("get_states", &Basis<T>::get_states)
         .def("get_number_of_states", &Basis<T>::get_number_of_states)
         .def("get_number_of_kets", &Basis<T>::get_number_of_kets)
         .def("get_quantum_number_f", &Basis<T>::get_quantum_number_f)
@@ -54,11 +55,17 @@ static void declare_basis(nb::module_ &m, std::string const &type_name) {
                  &Basis<T>::get_amplitudes, nb::const_))
         .def("get_amplitudes",
              nb::overload_cast<std::shared_ptr<const T>>(&Basis<T>::get_amplitudes, nb::const_))
+        .def("get_amplitudes",
+             nb::overload_cast<const typename Basis<T>::ketvec_t &>(&Basis<T>::get_amplitudes,
+                                                                     nb::const_))
         .def("get_overlaps",
              nb::overload_cast<std::shared_ptr<const typename Basis<T>::ket_t>>(
                  &Basis<T>::get_overlaps, nb::const_))
         .def("get_overlaps",
              nb::overload_cast<std::shared_ptr<const T>>(&Basis<T>::get_overlaps, nb::const_))
+        .def("get_overlaps",
+             nb::overload_cast<const typename Basis<T>::ketvec_t &>(&Basis<T>::get_overlaps,
+                                                                     nb::const_))
         .def("get_matrix_elements",
              nb::overload_cast<std::shared_ptr<const typename Basis<T>::ket_t>, OperatorType, int>(
                  &Basis<T>::get_matrix_elements, nb::const_))
@@ -91,6 +98,7 @@ template <typename T>
 static void declare_basis_atom(nb::module_ &m, std::string const &type_name) {
     std::string pyclass_name = "BasisAtom" + type_name;
     nb::class_<BasisAtom<T>, Basis<BasisAtom<T>>> pyclass(m, pyclass_name.c_str());
+    pyclass.def("restricted", &BasisAtom<T>::restricted);
 }
 
 template <typename T>
@@ -109,6 +117,7 @@ static void declare_basis_atom_creator(nb::module_ &m, std::string const &type_n
         .def("restrict_quantum_number_s", &BasisAtomCreator<T>::restrict_quantum_number_s)
         .def("restrict_quantum_number_j", &BasisAtomCreator<T>::restrict_quantum_number_j)
         .def("append_ket", &BasisAtomCreator<T>::append_ket)
+        .def("extend_basis", &BasisAtomCreator<T>::extend_basis)
         .def("create", &BasisAtomCreator<T>::create);
 }
 
@@ -129,11 +138,41 @@ static void declare_basis_classical_light_creator(nb::module_ &m, std::string co
         .def("create", &BasisClassicalLightCreator<T>::create);
 }
 
+// The kets of a pair basis are only valid as long as the basis exists, thus the kets that are
+// handed to Python keep the basis alive
+template <typename T>
+static std::shared_ptr<const KetPair<T>> keep_basis_alive(const BasisPair<T> &basis,
+                                                          std::shared_ptr<const KetPair<T>> ket) {
+    return {basis.shared_from_this(), ket.get()};
+}
+
 template <typename T>
 static void declare_basis_pair(nb::module_ &m, std::string const &type_name) {
     std::string pyclass_name = "BasisPair" + type_name;
+    using ketvec_t = typename BasisPair<T>::ketvec_t;
     nb::class_<BasisPair<T>, Basis<BasisPair<T>>> pyclass(m, pyclass_name.c_str());
     pyclass
+        .def("get_kets",
+             [](const BasisPair<T> &basis) {
+                 ketvec_t kets;
+                 kets.reserve(basis.get_number_of_kets());
+                 for (const auto &ket : basis.get_kets()) {
+                     kets.push_back(keep_basis_alive(basis, ket));
+                 }
+                 return kets;
+             })
+        .def("get_ket",
+             [](const BasisPair<T> &basis, size_t ket_index) {
+                 return keep_basis_alive(basis, basis.get_ket(ket_index));
+             })
+        .def("get_corresponding_ket",
+             [](const BasisPair<T> &basis, size_t state_index) {
+                 return keep_basis_alive(basis, basis.get_corresponding_ket(state_index));
+             })
+        .def("get_corresponding_ket",
+             [](const BasisPair<T> &basis, std::shared_ptr<const BasisPair<T>> state) {
+                 return keep_basis_alive(basis, basis.get_corresponding_ket(std::move(state)));
+             })
         .def("get_amplitudes",
              nb::overload_cast<std::shared_ptr<const KetAtom>, std::shared_ptr<const KetAtom>>(
                  &BasisPair<T>::get_amplitudes, nb::const_))
@@ -141,6 +180,13 @@ static void declare_basis_pair(nb::module_ &m, std::string const &type_name) {
              nb::overload_cast<std::shared_ptr<const BasisAtom<T>>,
                                std::shared_ptr<const BasisAtom<T>>>(&BasisPair<T>::get_amplitudes,
                                                                     nb::const_))
+        .def("get_amplitudes",
+             nb::overload_cast<const std::vector<std::shared_ptr<const KetAtom>> &,
+                               const std::vector<std::shared_ptr<const KetAtom>> &>(
+                 &BasisPair<T>::get_amplitudes, nb::const_))
+        .def("get_amplitudes",
+             nb::overload_cast<const typename BasisPair<T>::ketvec_t &>(
+                 &Basis<BasisPair<T>>::get_amplitudes, nb::const_))
         .def("get_overlaps",
              nb::overload_cast<std::shared_ptr<const KetAtom>, std::shared_ptr<const KetAtom>>(
                  &BasisPair<T>::get_overlaps, nb::const_))
@@ -148,6 +194,13 @@ static void declare_basis_pair(nb::module_ &m, std::string const &type_name) {
              nb::overload_cast<std::shared_ptr<const BasisAtom<T>>,
                                std::shared_ptr<const BasisAtom<T>>>(&BasisPair<T>::get_overlaps,
                                                                     nb::const_))
+        .def("get_overlaps",
+             nb::overload_cast<const std::vector<std::shared_ptr<const KetAtom>> &,
+                               const std::vector<std::shared_ptr<const KetAtom>> &>(
+                 &BasisPair<T>::get_overlaps, nb::const_))
+        .def("get_overlaps",
+             nb::overload_cast<const typename BasisPair<T>::ketvec_t &>(
+                 &Basis<BasisPair<T>>::get_overlaps, nb::const_))
         .def("get_matrix_elements",
              nb::overload_cast<std::shared_ptr<const BasisPair<T>>, OperatorType, OperatorType, int,
                                int>(&BasisPair<T>::get_matrix_elements, nb::const_))
@@ -174,6 +227,8 @@ static void declare_basis_pair_creator(nb::module_ &m, std::string const &type_n
         .def("restrict_energy", &BasisPairCreator<T>::restrict_energy)
         .def("restrict_quantum_number_m", &BasisPairCreator<T>::restrict_quantum_number_m)
         .def("restrict_product_of_parities", &BasisPairCreator<T>::restrict_product_of_parities)
+        .def("enable_exchange_symmetrization",
+             &BasisPairCreator<T>::enable_exchange_symmetrization)
         .def("create", &BasisPairCreator<T>::create);
 }
 
@@ -2,6 +2,7 @@
 
 #include "pairinteraction/basis/BasisAtom.hpp"
 #include "pairinteraction/database/Database.hpp"
+#include "pairinteraction/enums/FloatType.hpp"
 #include "pairinteraction/enums/OperatorType.hpp"
 #include "pairinteraction/ket/KetAtom.hpp"
 #include "pairinteraction/operator/OperatorAtom.hpp"
@@ -25,7 +26,17 @@ static void declare_database(nb::module_ &m) {
         .def(nb::init<bool>(), "download_missing"_a)
         .def(nb::init<std::filesystem::path>(), "database_dir"_a)
         .def(nb::init<bool, bool, std::filesystem::path>(), "download_missing"_a, "use_cache"_a,
-             "database_dir"_a);
+             "database_dir"_a)
+        .def(nb::init<bool, bool, std::filesystem::path, bool>(), "download_missing"_a,
+             "use_cache"_a, "database_dir"_a, "use_persistent_store"_a)
+        .def("set_use_native_index", nb::overload_cast<bool>(&Database::set_use_native_index),
+             "use_native_index"_a)
+        .def("set_use_native_index",
+             nb::overload_cast<bool, FloatType>(&Database::set_use_native_index),
+             "use_native_index"_a, "float_type"_a)
+        .def("get_use_native_index", &Database::get_use_native_index)
+        .def("set_prefetch_operators", &Database::set_prefetch_operators, "prefetch_operators"_a)
+        .def("get_prefetch_operators", &Database::get_prefetch_operators);
 }
 
 void bind_database(nb::module_ &m) { declare_database(m); }
@@ -29,6 +29,7 @@ static void declare_system(nb::module_ &m, std::string const &type_name) {
                                                                             pyclass_name.c_str());
     pyclass.def("get_basis", &System<T>::get_basis)
         .def("get_eigenbasis", &System<T>::get_eigenbasis)
+        .def("get_eigenbasis_overlaps", &System<T>::get_eigenbasis_overlaps)
         .def("get_eigenvalues", &System<T>::get_eigenvalues)
         .def("get_matrix", &System<T>::get_matrix)
         .def("get_transformation", &System<T>::get_transformation)
@@ -62,7 +63,9 @@ static void declare_system_pair(nb::module_ &m, std::string const &type_name) {
     pyclass.def(nb::init<std::shared_ptr<const basis_t>>())
         .def("set_order", &SystemPair<T>::set_order)
         .def("set_distance", &SystemPair<T>::set_distance)
-        .def("set_distance_vector", &SystemPair<T>::set_distance_vector);
+        .def("set_distance_vector", &SystemPair<T>::set_distance_vector)
+        .def("enable_interaction_caching", &SystemPair<T>::enable_interaction_caching)
+        .def("apply_hamiltonian", &SystemPair<T>::apply_hamiltonian);
 }
 
 void bind_system(nb::module_ &m) {
@@ -7,7 +7,9 @@
 
 #include <Eigen/Dense>
 #include <Eigen/SparseCore>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 #include <vector>
@@ -54,8 +56,12 @@ public:
     size_t get_number_of_kets() const;
     real_t get_quantum_number_f(size_t state_index) const;
     real_t get_quantum_number_m(size_t state_index) const;
+    // For pair bases that are symmetrized under the exchange of the atoms, the parity labels the
+    // exchange symmetry of a state (Parity::EVEN for symmetric, Parity::ODD for antisymmetric
+    // states) and not the spatial parity.
     Parity get_parity(size_t state_index) const;
     std::shared_ptr<const Derived> get_state(size_t state_index) const;
+    std::shared_ptr<const Derived> get_states(const std::vector<size_t> &state_indices) const;
     std::shared_ptr<const ket_t> get_ket(size_t ket_index) const;
     std::shared_ptr<const ket_t> get_corresponding_ket(size_t state_index) const;
     std::shared_ptr<const ket_t> get_corresponding_ket(std::shared_ptr<const Derived> state) const;
@@ -73,9 +79,11 @@ public:
     Eigen::VectorX<scalar_t> get_amplitudes(std::shared_ptr<const ket_t> ket) const;
     Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>
     get_amplitudes(std::shared_ptr<const Derived> other) const;
+    Eigen::SparseMatrix<scalar_t, Eigen::RowMajor> get_amplitudes(const ketvec_t &kets) const;
     Eigen::VectorX<real_t> get_overlaps(std::shared_ptr<const ket_t> ket) const;
     Eigen::SparseMatrix<real_t, Eigen::RowMajor>
     get_overlaps(std::shared_ptr<const Derived> other) const;
+    Eigen::SparseMatrix<real_t, Eigen::RowMajor> get_overlaps(const ketvec_t &kets) const;
     virtual Eigen::VectorX<scalar_t> get_matrix_elements(std::shared_ptr<const ket_t> ket,
                                                          OperatorType type, int q = 0) const = 0;
     Eigen::SparseMatrix<scalar_t, Eigen::RowMajor> virtual get_matrix_elements(
@@ -103,6 +111,7 @@ public:
 
     void perform_sorter_checks(const std::vector<TransformationType> &labels) const;
     void perform_blocks_checks(const std::set<TransformationType> &unique_labels) const;
+    bool is_sorted_by(const std::set<TransformationType> &unique_labels) const;
     void get_sorter_without_checks(const std::vector<TransformationType> &labels,
                                    Sorting &transformation) const;
     void get_indices_of_blocks_without_checks(const std::set<TransformationType> &unique_labels,
@@ -114,33 +123,67 @@ public:
 
 protected:
     Basis(ketvec_t &&kets);
+    // The transformation type describes an order of the kets that is known when the basis is
+    // created, e.g., that the kets are sorted by a quantum number
+    Basis(ketvec_t &&kets, std::vector<TransformationType> transformation_type);
     int get_ket_index_from_ket(std::shared_ptr<const ket_t> ket) const;
-    ketvec_t kets;
+
+    // Returns a copy of the basis whose states are labeled by the given parities, so that derived
+    // classes can label states by a symmetry that can not be inferred from the kets
+    std::shared_ptr<const Derived> with_parities(std::vector<Parity> parities) const;
 
 private:
     const Derived &derived() const;
 
-    struct hash {
-        std::size_t operator()(const std::shared_ptr<const ket_t> &k) const;
-    };
+    // Returns a key that identifies the ket cheaply, i.e., its id in the database for atomic kets
+    // and the tuple of atomic indices for pair kets. Different kets can share the same key, thus a
+    // match must be confirmed by comparing the kets.
+    static std::uint64_t get_ket_key(const ket_t &ket);
 
     struct equal_to {
         bool operator()(const std::shared_ptr<const ket_t> &lhs,
                         const std::shared_ptr<const ket_t> &rhs) const;
     };
 
-    Transformation<scalar_t> coefficients;
+    // The kets never change, thus they are shared by all bases that are derived from this basis,
+    // e.g., by get_state or transformed
+    struct KetData {
+        ketvec_t kets;
+        std::vector<std::pair<std::uint64_t, size_t>> ket_key_to_ket_index;
+    };
+
+    // A column-major copy of the coefficients, which is created on first use to extract single
+    // states without walking every row of the row-major coefficients
+    struct CoefficientsByColumn {
+        std::once_flag created;
+        Eigen::SparseMatrix<scalar_t, Eigen::ColMajor> matrix;
+    };
 
-    std::unordered_map<std::shared_ptr<const ket_t>, size_t, hash, equal_to> ket_to_ket_index;
-    std::vector<size_t> ket_index_to_state_index;
+    // The states are shared by copies of the basis and are copied before they get modified
+    struct StateData {
+        Transformation<scalar_t> coefficients;
+        std::shared_ptr<CoefficientsByColumn> coefficients_by_column{
+            std::make_shared<CoefficientsByColumn>()};
+
+        // Sorted by the ket index, kets that do not belong to a state are omitted
+        std::vector<std::pair<size_t, size_t>> ket_index_to_state_index;
+
+        std::vector<real_t> state_index_to_quantum_number_f;
+        std::vector<real_t> state_index_to_quantum_number_m;
+        std::vector<Parity> state_index_to_parity;
+        std::vector<size_t> state_index_to_ket_index;
+
+        bool _has_quantum_number_f{true};
+        bool _has_quantum_number_m{true};
+        bool _has_parity{true};
+    };
 
-    std::vector<real_t> state_index_to_quantum_number_f;
-    std::vector<real_t> state_index_to_quantum_number_m;
-    std::vector<Parity> state_index_to_parity;
-    std::vector<size_t> state_index_to_ket_index;
+    std::shared_ptr<const KetData> ket_data;
+    std::shared_ptr<StateData> state_data;
 
-    bool _has_quantum_number_f{true};
-    bool _has_quantum_number_m{true};
-    bool _has_parity{true};
+    size_t get_state_index_from_ket_index(size_t ket_index) const;
+    const Eigen::SparseMatrix<scalar_t, Eigen::ColMajor> &get_coefficients_by_column() const;
+    int get_ket_index_for_different_quantum_number_m(size_t ket_index,
+                                                     real_t new_quantum_number_m) const;
 };
 } // namespace pairinteraction
@@ -53,6 +53,21 @@ public:
 
     int get_ket_index_from_id(size_t ket_id) const;
 
+    /**
+     * @brief Create a basis that consists of a subset of the kets of this basis.
+     *
+     * @details The restricted basis shares the kets of this basis. Its operators are obtained by
+     * slicing the operators of this basis, so that no database queries are necessary if the
+     * operators of this basis have been calculated already. Note that the coefficients of this
+     * basis are not inherited, i.e., the states of the restricted basis are its kets.
+     *
+     * @param ket_indices The indices of the kets that the restricted basis consists of. The
+     * indices must be unique and smaller than the number of kets.
+     *
+     * @return The restricted basis.
+     */
+    std::shared_ptr<const Type> restricted(const std::vector<size_t> &ket_indices) const;
+
     Eigen::VectorX<Scalar> get_matrix_elements(std::shared_ptr<const ket_t> ket, OperatorType type,
                                                int q = 0) const override;
     Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
@@ -63,7 +78,9 @@ private:
     std::string id_of_kets;
     Database &database;
     std::string species;
-    std::unordered_map<size_t, size_t> ket_id_to_ket_index;
+    std::shared_ptr<const std::unordered_map<size_t, size_t>> ket_id_to_ket_index;
+    std::shared_ptr<const Type> parent_basis;
+    std::shared_ptr<const std::vector<size_t>> parent_ket_indices;
 };
 
 extern template class BasisAtom<double>;
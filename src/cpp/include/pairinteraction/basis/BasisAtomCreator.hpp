@@ -47,6 +47,7 @@ public:
     BasisAtomCreator<Scalar> &restrict_quantum_number_l_ryd(real_t min, real_t max);
     BasisAtomCreator<Scalar> &restrict_quantum_number_j_ryd(real_t min, real_t max);
     BasisAtomCreator<Scalar> &append_ket(const std::shared_ptr<const ket_t> &ket);
+    BasisAtomCreator<Scalar> &extend_basis(std::shared_ptr<const BasisAtom<Scalar>> basis);
     std::shared_ptr<const BasisAtom<Scalar>> create(Database &database) const;
 
 private:
@@ -65,6 +66,7 @@ private:
     Range<real_t> range_quantum_number_j_ryd;
     std::vector<size_t> additional_ket_ids;
     std::optional<std::string> additional_ket_species;
+    std::shared_ptr<const BasisAtom<Scalar>> basis_to_extend;
 };
 
 extern template class BasisAtomCreator<double>;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pairinteraction/basis/Basis.hpp"
+#include "pairinteraction/ket/KetPair.hpp"
 #include "pairinteraction/utils/Range.hpp"
 #include "pairinteraction/utils/eigen_assertion.hpp"
 #include "pairinteraction/utils/eigen_compat.hpp"
@@ -9,8 +10,13 @@
 
 #include <Eigen/Dense>
 #include <Eigen/SparseCore>
+#include <array>
 #include <complex>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -18,9 +24,6 @@ namespace pairinteraction {
 template <typename Scalar>
 class BasisPairCreator;
 
-template <typename Scalar>
-class KetPair;
-
 template <typename Scalar>
 class BasisPair;
 
@@ -29,6 +32,8 @@ class BasisAtom;
 
 class KetAtom;
 
+enum class TransformationType : unsigned char;
+
 template <typename Scalar>
 struct traits::CrtpTraits<BasisPair<Scalar>> {
     using scalar_t = Scalar;
@@ -54,12 +59,19 @@ public:
     using map_size_t = std::unordered_map<size_t, size_t>;
     using map_range_t = std::unordered_map<size_t, range_t>;
     using map_indices_t =
-        std::unordered_map<std::vector<size_t>, size_t, utils::hash<std::vector<size_t>>>;
+        std::unordered_map<std::array<size_t, 2>, size_t, utils::hash<std::array<size_t, 2>>>;
+
+    // The kets are stored contiguously and owned by the basis, see ket_storage
+    struct KetStorage {
+        typename ket_t::atomic_bases_t atomic_bases;
+        std::vector<std::optional<ket_t>> kets;
+    };
 
-    BasisPair(Private /*unused*/, ketvec_t &&kets, map_range_t &&map_range_of_state_index2,
-              map_indices_t &&state_indices_to_ket_index,
+    BasisPair(Private /*unused*/, ketvec_t &&kets, std::shared_ptr<const KetStorage> ket_storage,
+              map_range_t &&map_range_of_state_index2, map_indices_t &&state_indices_to_ket_index,
               std::shared_ptr<const BasisAtom<Scalar>> basis1,
-              std::shared_ptr<const BasisAtom<Scalar>> basis2);
+              std::shared_ptr<const BasisAtom<Scalar>> basis2,
+              std::vector<TransformationType> transformation_type);
     const range_t &get_index_range(size_t state_index1) const;
     std::shared_ptr<const BasisAtom<Scalar>> get_basis1() const;
     std::shared_ptr<const BasisAtom<Scalar>> get_basis2() const;
@@ -70,9 +82,16 @@ public:
     Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
     get_amplitudes(std::shared_ptr<const BasisAtom<Scalar>> other1,
                    std::shared_ptr<const BasisAtom<Scalar>> other2) const;
+    // Returns one row of amplitudes for each pair of kets (kets1[i], kets2[i])
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
+    get_amplitudes(const std::vector<std::shared_ptr<const KetAtom>> &kets1,
+                   const std::vector<std::shared_ptr<const KetAtom>> &kets2) const;
     Eigen::VectorX<real_t> get_overlaps(std::shared_ptr<const KetAtom> ket1,
                                         std::shared_ptr<const KetAtom> ket2) const;
     Eigen::SparseMatrix<real_t, Eigen::RowMajor>
+    get_overlaps(const std::vector<std::shared_ptr<const KetAtom>> &kets1,
+                 const std::vector<std::shared_ptr<const KetAtom>> &kets2) const;
+    Eigen::SparseMatrix<real_t, Eigen::RowMajor>
     get_overlaps(std::shared_ptr<const BasisAtom<Scalar>> other1,
                  std::shared_ptr<const BasisAtom<Scalar>> other2) const;
 
@@ -95,11 +114,53 @@ public:
                         std::shared_ptr<const BasisAtom<Scalar>> final2, OperatorType type1,
                         OperatorType type2, int q1 = 0, int q2 = 0) const;
 
+    // Returns the matrix elements of the operator type1 ⊗ type2 between the kets of this basis.
+    // The matrices are cached and shared by all bases that are derived from this basis, so that
+    // they are only calculated once, e.g., when the direction of the distance between the atoms
+    // is scanned.
+    std::shared_ptr<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>
+    get_matrix_elements_of_kets(OperatorType type1, OperatorType type2, int q1 = 0,
+                                int q2 = 0) const;
+
 private:
-    map_range_t map_range_of_state_index2;
-    map_indices_t state_indices_to_ket_index;
+    // Calculates sum_{i,j} vector1[i] * vector2[j] * coefficients.row(ket_index(i, j)), where the
+    // vectors are indexed by the states of basis1 and basis2
+    Eigen::VectorX<Scalar>
+    contract_with_coefficients(const Eigen::SparseVector<Scalar> &vector1,
+                               const Eigen::SparseVector<Scalar> &vector2) const;
+
+    // Returns the matrix elements of the operator type between the states of basis1 (atom = 0) or
+    // basis2 (atom = 1), so that the matrix elements of a single state can be read from a row
+    std::shared_ptr<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>
+    get_matrix_elements_of_atom(size_t atom, OperatorType type, int q) const;
+
+    // The kets of the basis do not own the objects they point to, which are owned by this storage
+    // instead. Thus, creating and copying a ket does not touch a shared reference count, but a ket
+    // is only valid as long as this basis or a basis derived from it exists.
+    std::shared_ptr<const KetStorage> ket_storage;
+
+    // The maps never change, thus they are shared by all bases derived from this basis
+    std::shared_ptr<const map_range_t> map_range_of_state_index2;
+    std::shared_ptr<const map_indices_t> state_indices_to_ket_index;
     std::shared_ptr<const BasisAtom<Scalar>> basis1;
     std::shared_ptr<const BasisAtom<Scalar>> basis2;
+
+    // The cache stores a future for each matrix so that a matrix is calculated only once without
+    // holding the lock during the calculation. Concurrent callers wait for the future instead.
+    using cached_matrix_t =
+        std::shared_future<std::shared_ptr<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>>;
+    struct MatrixElementsCache {
+        std::mutex mutex;
+        std::map<std::array<int, 4>, cached_matrix_t> matrices;
+        std::map<std::array<int, 3>, cached_matrix_t> atomic_matrices;
+    };
+    std::shared_ptr<MatrixElementsCache> matrix_elements_cache;
+
+    // Returns the matrix that is cached for the key, calculating it by compute() if required
+    template <typename Key, typename Compute>
+    std::shared_ptr<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>
+    get_cached_matrix(std::map<Key, cached_matrix_t> &matrices, const Key &key,
+                      Compute &&compute) const;
 };
 
 extern template class BasisPair<double>;
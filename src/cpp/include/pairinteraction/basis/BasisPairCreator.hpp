@@ -34,6 +34,12 @@ public:
     BasisPairCreator<Scalar> &restrict_energy(real_t min, real_t max);
     BasisPairCreator<Scalar> &restrict_quantum_number_m(real_t min, real_t max);
     BasisPairCreator<Scalar> &restrict_product_of_parities(Parity value);
+    // For two identical atoms, the pair states can be chosen symmetric or antisymmetric under the
+    // exchange of the atoms. The symmetric states are labeled by Parity::EVEN, the antisymmetric
+    // ones by Parity::ODD, so that the Hamiltonian can be block-diagonalized by this label.
+    BasisPairCreator<Scalar> &enable_exchange_symmetrization(bool enable);
+    // The kets of the created basis are stored in one contiguous allocation that is owned by the
+    // basis. A ket is thus only valid as long as the basis or a basis derived from it exists.
     std::shared_ptr<const BasisPair<Scalar>> create() const;
 
 private:
@@ -41,6 +47,7 @@ private:
     Range<real_t> range_energy;
     Range<real_t> range_quantum_number_m;
     Parity product_of_parities; // NOLINT
+    bool exchange_symmetrization;
 };
 
 extern template class BasisPairCreator<double>;
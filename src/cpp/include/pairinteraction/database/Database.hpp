@@ -1,14 +1,19 @@
 #pragma once
 
+#include "pairinteraction/enums/FloatType.hpp"
 #include "pairinteraction/utils/eigen_assertion.hpp"
 #include "pairinteraction/utils/traits.hpp"
 
 #include <Eigen/SparseCore>
+#include <atomic>
 #include <complex>
 #include <filesystem>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <oneapi/tbb.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace duckdb {
@@ -30,14 +35,20 @@ class BasisAtom;
 
 class GitHubDownloader;
 
+class MatrixElementsIndex;
+
 class ParquetManager;
 
+class StatesIndex;
+
 class Database {
 public:
     Database();
     Database(bool download_missing);
     Database(std::filesystem::path database_dir);
     Database(bool download_missing, bool use_cache, std::filesystem::path database_dir);
+    Database(bool download_missing, bool use_cache, std::filesystem::path database_dir,
+             bool use_persistent_store);
     ~Database();
     static Database &get_global_instance();
     static Database &get_global_instance(bool download_missing);
@@ -53,6 +64,15 @@ public:
                                                        const AtomDescriptionByRanges &description,
                                                        std::vector<size_t> additional_ket_ids);
 
+    // Returns a basis that contains the kets of the given basis and the described kets. The matrix
+    // elements between the kets of the given basis are reused if they are cached, so that only the
+    // matrix elements involving new kets are queried from the database.
+    template <typename Scalar>
+    std::shared_ptr<const BasisAtom<Scalar>>
+    extend_basis(std::shared_ptr<const BasisAtom<Scalar>> basis,
+                 const AtomDescriptionByRanges &description,
+                 std::vector<size_t> additional_ket_ids);
+
     template <typename Scalar>
     Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
     get_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> initial_basis,
@@ -61,6 +81,19 @@ public:
 
     bool get_download_missing() const;
     bool get_use_cache() const;
+    bool get_use_persistent_store() const;
+    // If enabled, matrix elements are assembled from a native in-memory index of the matrix
+    // elements tables, which is built once per table, instead of being queried from DuckDB. With
+    // FloatType::FLOAT32, the index stores the reduced matrix elements in single precision, see
+    // MatrixElementsIndex for the resulting error bound.
+    void set_use_native_index(bool use_native_index);
+    void set_use_native_index(bool use_native_index, FloatType float_type);
+    bool get_use_native_index() const;
+    // If enabled, the operators d, q, mu and q0 of a basis are computed on background TBB tasks as
+    // soon as the basis is obtained from the database. Requesting such an operator then blocks only
+    // until the background task has finished.
+    void set_prefetch_operators(bool prefetch_operators);
+    bool get_prefetch_operators() const;
     std::filesystem::path get_database_dir() const;
 
 private:
@@ -78,14 +111,43 @@ private:
 
     bool download_missing_;
     bool use_cache_;
+    bool use_persistent_store_;
     std::filesystem::path database_dir_;
     std::unique_ptr<duckdb::DuckDB> db;
     std::unique_ptr<duckdb::Connection> con;
     std::unique_ptr<GitHubDownloader> downloader;
     std::unique_ptr<ParquetManager> manager;
+    std::mutex mtx_states_indices;
+    std::unordered_map<std::string, std::shared_ptr<const StatesIndex>> states_indices;
+    std::mutex mtx_kets;
+    std::unordered_map<std::string, std::shared_ptr<const KetAtom>> kets;
+    std::atomic<bool> use_native_index_{false};
+    std::atomic<FloatType> native_index_float_type_{FloatType::FLOAT64};
+    std::mutex mtx_matrix_elements_indices;
+    std::unordered_map<std::string, std::shared_ptr<const MatrixElementsIndex>>
+        matrix_elements_indices;
+
+    struct BasisExtension {
+        std::string parent_id_of_kets;
+        std::vector<int> parent_to_child_index;
+    };
+
+    oneapi::tbb::concurrent_unordered_map<std::string, BasisExtension> basis_extensions;
+
+    struct PrefetchTask {
+        std::atomic<bool> claimed{false};
+        std::promise<void> promise;
+        std::shared_future<void> done{promise.get_future().share()};
+    };
+
+    std::atomic<bool> prefetch_operators_{false};
+    std::mutex mtx_prefetch_tasks;
+    std::unordered_map<std::string, std::shared_ptr<PrefetchTask>> prefetch_tasks;
+    oneapi::tbb::task_group prefetch_task_group;
 
     static constexpr bool default_download_missing{false};
     static constexpr bool default_use_cache{true};
+    static constexpr bool default_use_persistent_store{false};
     static const std::filesystem::path default_database_dir;
 
     static oneapi::tbb::concurrent_unordered_map<std::string,
@@ -95,6 +157,31 @@ private:
     static Database &get_global_instance_without_checks(bool download_missing, bool use_cache,
                                                         std::filesystem::path database_dir);
 
+    std::shared_ptr<const StatesIndex> get_states_index(const std::string &species);
+
+    std::shared_ptr<const MatrixElementsIndex>
+    get_matrix_elements_index(const std::string &species, const std::string &specifier);
+
+    template <typename Scalar>
+    std::shared_ptr<const BasisAtom<Scalar>>
+    get_basis_without_checks(const std::string &species,
+                             const AtomDescriptionByRanges &description,
+                             std::vector<size_t> additional_ket_ids,
+                             std::shared_ptr<const BasisAtom<Scalar>> parent_basis);
+
+    template <typename Scalar>
+    void prefetch_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> basis);
+
+    static std::string get_prefetch_key(const std::string &id_of_kets, OperatorType type, int q);
+
+    void complete_prefetch_task(const std::string &key, PrefetchTask &task);
+
+    template <typename Scalar>
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
+    get_matrix_elements_without_prefetch(std::shared_ptr<const BasisAtom<Scalar>> initial_basis,
+                                         std::shared_ptr<const BasisAtom<Scalar>> final_basis,
+                                         OperatorType type, int q);
+
     void ensure_presence_of_table(const std::string &name);
 };
 
@@ -104,6 +191,9 @@ private:
     extern template std::shared_ptr<const BasisAtom<SCALAR>> Database::get_basis<SCALAR>(          \
         const std::string &species, const AtomDescriptionByRanges &description,                    \
         std::vector<size_t> additional_ket_ids);                                                   \
+    extern template std::shared_ptr<const BasisAtom<SCALAR>> Database::extend_basis<SCALAR>(       \
+        std::shared_ptr<const BasisAtom<SCALAR>> basis,                                            \
+        const AtomDescriptionByRanges &description, std::vector<size_t> additional_ket_ids);       \
     extern template Eigen::SparseMatrix<SCALAR, Eigen::RowMajor>                                   \
     Database::get_matrix_elements<SCALAR>(std::shared_ptr<const BasisAtom<SCALAR>> initial_basis,  \
                                           std::shared_ptr<const BasisAtom<SCALAR>> final_basis,    \
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "pairinteraction/enums/FloatType.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace duckdb {
+class Connection;
+} // namespace duckdb
+
+namespace pairinteraction {
+/**
+ * @class MatrixElementsIndex
+ *
+ * @brief Compact in-memory index of a table of reduced matrix elements.
+ *
+ * @details The rows of the table are stored sorted by (id_initial, id_final) in flat arrays. Each
+ * id_initial is mapped to the contiguous slice of its rows so that the reduced matrix elements
+ * belonging to a state can be looked up without querying the database. To reduce the memory
+ * footprint, the ids are stored as 32-bit integers and the sorted ids_final within a slice are
+ * delta-encoded as variable-length integers, which typically take one or two bytes per entry.
+ *
+ * If the index is created with FloatType::FLOAT32, the reduced matrix elements are stored in
+ * single precision. Each returned value then has a relative error of at most 2^-24 (about 6e-8),
+ * the unit roundoff of single precision. With FloatType::FLOAT64, the values are exact.
+ */
+class MatrixElementsIndex {
+public:
+    MatrixElementsIndex(duckdb::Connection &con, const std::string &path, FloatType float_type);
+
+    // Calls function(id_final, value) for each row that belongs to the given id_initial, in
+    // ascending order of id_final
+    template <typename Function>
+    void for_each_entry(int64_t id_initial, Function &&function) const;
+
+    size_t get_number_of_entries() const;
+    size_t get_memory_usage() const;
+
+private:
+    std::vector<uint32_t> ids_initial;
+    std::vector<size_t> offsets;
+    std::vector<size_t> byte_offsets;
+    std::vector<uint8_t> encoded_ids_final;
+    std::vector<double> values_double;
+    std::vector<float> values_float;
+};
+
+template <typename Function>
+void MatrixElementsIndex::for_each_entry(int64_t id_initial, Function &&function) const {
+    if (id_initial < 0 || id_initial > static_cast<int64_t>(UINT32_MAX)) {
+        return;
+    }
+    auto it =
+        std::lower_bound(ids_initial.begin(), ids_initial.end(), static_cast<uint32_t>(id_initial));
+    if (it == ids_initial.end() || *it != static_cast<uint32_t>(id_initial)) {
+        return;
+    }
+    auto idx = static_cast<size_t>(std::distance(ids_initial.begin(), it));
+
+    // Decode the ids_final, the first one is stored relative to zero
+    const uint8_t *byte = encoded_ids_final.data() + byte_offsets[idx];
+    uint32_t id_final = 0;
+    for (size_t i = offsets[idx]; i < offsets[idx + 1]; i++) {
+        uint32_t delta = 0;
+        int shift = 0;
+        while ((*byte & 0x80U) != 0) {
+            delta |= static_cast<uint32_t>(*byte & 0x7FU) << shift;
+            shift += 7;
+            ++byte;
+        }
+        delta |= static_cast<uint32_t>(*byte) << shift;
+        ++byte;
+        id_final += delta;
+        function(static_cast<int64_t>(id_final),
+                 values_float.empty() ? values_double[i] : static_cast<double>(values_float[i]));
+    }
+}
+} // namespace pairinteraction
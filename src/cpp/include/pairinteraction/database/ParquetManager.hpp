@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <regex>
 #include <shared_mutex>
@@ -20,6 +21,11 @@ public:
     struct PathInfo {
         std::string path;
         bool cached = false;
+        std::string source{};
+        std::string scope_column{};
+        std::vector<std::pair<int64_t, int64_t>> cached_ranges{};
+        bool sort_columns_known = false;
+        std::vector<std::string> sort_columns{};
     };
 
     struct LocalAssetInfo {
@@ -34,21 +40,49 @@ public:
 
     ParquetManager(std::filesystem::path directory, const GitHubDownloader &downloader,
                    std::vector<std::string> repo_paths, duckdb::Connection &con, bool use_cache);
+    // If use_persistent_store is true, the tables are imported once into a DuckDB database file
+    // in the given directory. The file stores the tables sorted and indexed by their ids, the
+    // states additionally indexed by their quantum numbers, and is attached read-only, so that it
+    // can be shared by many processes. If an asset is updated, only its tables are re-imported.
+    ParquetManager(std::filesystem::path directory, const GitHubDownloader &downloader,
+                   std::vector<std::string> repo_paths, duckdb::Connection &con, bool use_cache,
+                   bool use_persistent_store);
     void scan_local();
     void scan_remote();
     std::string get_path(const std::string &key, const std::string &table);
+    // Returns a path that is only guaranteed to contain the rows whose column lies within
+    // [min_value, max_value]. If caching is enabled, only these rows are materialized in memory and
+    // the cached subset grows with every call. Queries against the returned path must thus be
+    // restricted to the requested range. If min_value > max_value, the range is empty and nothing
+    // is cached.
+    std::string get_path(const std::string &key, const std::string &table,
+                         const std::string &column, int64_t min_value, int64_t max_value);
+    // Returns the columns by which the rows of the table are sorted, as recorded in the 'sorted_by'
+    // key-value metadata of the parquet file, or an empty vector if the ordering is unknown.
+    std::vector<std::string> get_sort_columns(const std::string &key, const std::string &table);
     std::string get_versions_info() const;
 
 private:
     void react_on_rate_limit_reached(std::time_t reset_time);
     void update_local_asset(const std::string &key);
+    std::unordered_map<std::string, PathInfo>::iterator get_table_it(const std::string &key,
+                                                                      const std::string &table);
+    std::string create_unique_table_name();
     void cache_table(std::unordered_map<std::string, PathInfo>::iterator table_it);
+    void cache_table_range(std::unordered_map<std::string, PathInfo>::iterator table_it,
+                           const std::string &column, int64_t min_value, int64_t max_value);
+    void attach_store();
+    void build_store();
+    void use_table_from_store(const std::string &key,
+                              std::unordered_map<std::string, PathInfo>::iterator table_it);
 
     std::filesystem::path directory_;
     const GitHubDownloader &downloader;
     std::vector<std::string> repo_paths_;
     duckdb::Connection &con;
     bool use_cache_;
+    bool use_persistent_store_;
+    std::unordered_map<std::string, int> store_asset_versions;
     std::unordered_map<std::string, LocalAssetInfo> local_asset_info;
     std::unordered_map<std::string, RemoteAssetInfo> remote_asset_info;
     std::regex local_regex{R"(^(\w+)_v(\d+)\.(\d+)$)"};
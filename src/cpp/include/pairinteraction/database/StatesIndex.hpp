@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace duckdb {
+class Connection;
+} // namespace duckdb
+
+namespace pairinteraction {
+struct AtomDescriptionByParameters;
+
+/**
+ * @class StatesIndex
+ *
+ * @brief In-memory index of a table of states.
+ *
+ * @details The rows of the table are loaded once and stored sorted by (n, id). A state that is
+ * described by quantum numbers can then be resolved without querying the database. The matching
+ * follows the same rules as the former SQL query of Database::get_ket, i.e., the states are
+ * filtered by the specified quantum numbers and ranked by the sum of the squared deviations of
+ * their expectation values from the specified quantum numbers.
+ */
+class StatesIndex {
+public:
+    struct State {
+        double energy;
+        double quantum_number_f;
+        int64_t parity;
+        int64_t id;
+        int64_t quantum_number_n;
+        double quantum_number_nu;
+        double quantum_number_nui_exp;
+        double quantum_number_nui_std;
+        double quantum_number_l_exp;
+        double quantum_number_l_std;
+        double quantum_number_s_exp;
+        double quantum_number_s_std;
+        double quantum_number_j_exp;
+        double quantum_number_j_std;
+        double quantum_number_l_ryd_exp;
+        double quantum_number_l_ryd_std;
+        double quantum_number_j_ryd_exp;
+        double quantum_number_j_ryd_std;
+        bool is_j_total_momentum;
+        bool is_calculated_with_mqdt;
+    };
+
+    struct Match {
+        const State *state;
+        double order_val;
+    };
+
+    StatesIndex(duckdb::Connection &con, const std::string &path);
+
+    // Returns the (at most two) best matching states, sorted by ascending order value
+    std::vector<Match> find(const AtomDescriptionByParameters &description) const;
+
+    size_t get_number_of_states() const;
+
+private:
+    std::vector<State> states;
+};
+} // namespace pairinteraction
@@ -3,8 +3,8 @@
 #include "pairinteraction/ket/Ket.hpp"
 #include "pairinteraction/utils/traits.hpp"
 
+#include <array>
 #include <complex>
-#include <initializer_list>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -27,14 +27,17 @@ class KetPair : public Ket {
     struct Private {};
 
 public:
-    KetPair(Private /*unused*/, std::initializer_list<size_t> atomic_indices,
-            std::initializer_list<std::shared_ptr<const BasisAtom<Scalar>>> atomic_bases,
+    using atomic_indices_t = std::array<size_t, 2>;
+    using atomic_bases_t = std::array<std::shared_ptr<const BasisAtom<Scalar>>, 2>;
+
+    KetPair(Private /*unused*/, atomic_indices_t atomic_indices, const atomic_bases_t *atomic_bases,
             real_t energy);
 
     std::string get_label() const override;
     std::shared_ptr<KetPair<Scalar>>
     get_ket_for_different_quantum_number_m(real_t new_quantum_number_m) const;
     std::vector<std::shared_ptr<const BasisAtom<Scalar>>> get_atomic_states() const;
+    const atomic_indices_t &get_atomic_indices() const;
 
     bool operator==(const KetPair<Scalar> &other) const;
     bool operator!=(const KetPair<Scalar> &other) const;
@@ -44,17 +47,16 @@ public:
     };
 
 private:
-    std::vector<size_t> atomic_indices;
-    std::vector<std::shared_ptr<const BasisAtom<Scalar>>> atomic_bases;
-    static real_t
-    calculate_quantum_number_f(const std::vector<size_t> &indices,
-                               const std::vector<std::shared_ptr<const BasisAtom<Scalar>>> &bases);
-    static real_t
-    calculate_quantum_number_m(const std::vector<size_t> &indices,
-                               const std::vector<std::shared_ptr<const BasisAtom<Scalar>>> &bases);
-    static Parity
-    calculate_parity(const std::vector<size_t> &indices,
-                     const std::vector<std::shared_ptr<const BasisAtom<Scalar>>> &bases);
+    // The atomic bases are owned by the pair basis that stores the ket, so that a ket only stores
+    // the indices of its atomic states and a pointer that can be copied without touching a shared
+    // reference count
+    atomic_indices_t atomic_indices;
+    const atomic_bases_t *atomic_bases;
+    static real_t calculate_quantum_number_f(const atomic_indices_t &indices,
+                                             const atomic_bases_t *bases);
+    static real_t calculate_quantum_number_m(const atomic_indices_t &indices,
+                                             const atomic_bases_t *bases);
+    static Parity calculate_parity(const atomic_indices_t &indices, const atomic_bases_t *bases);
 };
 
 extern template class KetPair<double>;
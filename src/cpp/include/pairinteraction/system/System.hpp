@@ -5,6 +5,7 @@
 #include "pairinteraction/utils/eigen_compat.hpp"
 #include "pairinteraction/utils/traits.hpp"
 
+#include <Eigen/Dense>
 #include <Eigen/SparseCore>
 #include <memory>
 #include <optional>
@@ -23,6 +24,7 @@ class System
 public:
     using scalar_t = typename traits::CrtpTraits<Derived>::scalar_t;
     using real_t = typename traits::CrtpTraits<Derived>::real_t;
+    using ket_t = typename traits::CrtpTraits<Derived>::ket_t;
     using ketvec_t = typename traits::CrtpTraits<Derived>::ketvec_t;
     using basis_t = typename traits::CrtpTraits<Derived>::basis_t;
     using operator_t = typename traits::CrtpTraits<Derived>::operator_t;
@@ -36,6 +38,7 @@ public:
 
     std::shared_ptr<const basis_t> get_basis() const;
     std::shared_ptr<const basis_t> get_eigenbasis() const;
+    Eigen::VectorX<real_t> get_eigenbasis_overlaps(std::shared_ptr<const ket_t> ket) const;
     Eigen::VectorX<real_t> get_eigenvalues() const;
 
     const Eigen::SparseMatrix<scalar_t, Eigen::RowMajor> &get_matrix() const;
@@ -65,7 +68,30 @@ protected:
 
     virtual void construct_hamiltonian() const = 0;
 
+    // Applies the eigenvectors of the last diagonalization to the basis if this is pending,
+    // without constructing the Hamiltonian
+    void construct_eigenbasis() const;
+
 private:
+    // Eigenvectors of a diagonal block of the Hamiltonian. The block is stored densely if this
+    // takes less memory than sparse storage.
+    struct EigenvectorBlock {
+        Eigen::Index row_offset{0};
+        Eigen::Index col_offset{0};
+        bool is_dense{false};
+        Eigen::MatrixX<scalar_t> dense;
+        Eigen::SparseMatrix<scalar_t, Eigen::RowMajor> sparse;
+        Eigen::Index rows() const { return is_dense ? dense.rows() : sparse.rows(); }
+        Eigen::Index cols() const { return is_dense ? dense.cols() : sparse.cols(); }
+    };
+
+    // Eigenvectors of the last diagonalization that have not yet been applied to the basis
+    mutable std::optional<std::vector<EigenvectorBlock>> pending_eigenvectors;
+
+    // Constructs the Hamiltonian if required and, unless apply_pending_eigenvectors is false,
+    // applies the pending eigenvectors to its basis. Only callers that solely access the matrix or
+    // handle the pending eigenvectors themselves may skip applying them.
+    void update_hamiltonian(bool apply_pending_eigenvectors = true) const;
     const Derived &derived() const;
 };
 } // namespace pairinteraction
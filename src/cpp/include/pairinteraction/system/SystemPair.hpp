@@ -3,6 +3,8 @@
 #include "pairinteraction/system/System.hpp"
 #include "pairinteraction/utils/traits.hpp"
 
+#include <Eigen/Dense>
+#include <Eigen/SparseCore>
 #include <array>
 #include <limits>
 #include <memory>
@@ -27,6 +29,11 @@ class SystemAtom;
 template <typename Scalar>
 class BasisAtom;
 
+namespace utils {
+template <typename Scalar>
+class TensorProductOperator;
+} // namespace utils
+
 template <typename Scalar>
 struct traits::CrtpTraits<SystemPair<Scalar>> {
     using scalar_t = Scalar;
@@ -52,10 +59,32 @@ public:
     Type &set_distance(real_t value);
     Type &set_distance_vector(const std::array<real_t, 3> &vector);
 
+    // Caches the angle-independent interaction matrices in the basis so that Hamiltonians for
+    // many directions of the distance vector only differ by a weighted sum of cached matrices
+    Type &enable_interaction_caching(bool enable);
+
+    // Applies the Hamiltonian to a vector of amplitudes of the states of the basis without
+    // constructing the Hamiltonian, e.g., for iterative eigensolvers or time propagation
+    Eigen::VectorX<Scalar> apply_hamiltonian(const Eigen::VectorX<Scalar> &vector) const;
+
 private:
     int order{3};
+    bool cache_interaction{false};
     std::array<real_t, 3> distance_vector{0, 0, std::numeric_limits<real_t>::infinity()};
 
+    // The Hamiltonian in the space of the kets, written as the energies of the kets plus the
+    // interaction sum_i matrices1[i] ⊗ matrices2[i] of single-atom matrices, where the
+    // contributions of all multipole orders that share the operator of the first atom are
+    // combined into a single term. The lazy tensor products of the terms refer to the matrices
+    // and are created once together with them.
+    struct HamiltonianFactors {
+        Eigen::VectorX<Scalar> energies;
+        std::vector<Eigen::SparseMatrix<Scalar, Eigen::RowMajor>> matrices1;
+        std::vector<Eigen::SparseMatrix<Scalar, Eigen::RowMajor>> matrices2;
+        std::vector<utils::TensorProductOperator<Scalar>> tensor_products;
+    };
+    mutable std::shared_ptr<const HamiltonianFactors> hamiltonian_factors;
+
     void construct_hamiltonian() const override;
 };
 
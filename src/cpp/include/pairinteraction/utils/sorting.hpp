@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <oneapi/tbb.h>
+#include <utility>
+#include <vector>
+
+namespace pairinteraction::sorting {
+
+/**
+ * @brief Stable sort of values by integer keys.
+ *
+ * @details The values are reordered so that their keys are in ascending order, values with equal
+ * keys keep their relative order. Only the lowest number_of_bits bits of the keys are taken into
+ * account. Large arrays are sorted by a least-significant-digit radix sort whose histogram and
+ * scatter steps run in parallel over chunks of the array, small arrays by std::stable_sort.
+ *
+ * @param keys The keys, one for each value. They are reordered together with the values.
+ * @param values Pointer to the first of keys.size() values.
+ * @param number_of_bits The number of bits of the keys that are used for sorting.
+ */
+template <typename Value>
+inline void stable_sort_by_key(std::vector<std::uint64_t> &keys, Value *values,
+                               int number_of_bits) {
+    constexpr size_t chunk_size = 1 << 14;
+    constexpr int bits_per_digit = 8;
+    constexpr size_t radix = size_t{1} << bits_per_digit;
+
+    size_t number_of_values = keys.size();
+    if (number_of_values < 2 || number_of_bits <= 0) {
+        return;
+    }
+
+    if (number_of_values <= chunk_size) {
+        std::vector<std::pair<std::uint64_t, Value>> pairs(number_of_values);
+        for (size_t i = 0; i < number_of_values; ++i) {
+            pairs[i] = {keys[i], values[i]};
+        }
+        std::stable_sort(pairs.begin(), pairs.end(),
+                         [](const auto &a, const auto &b) { return a.first < b.first; });
+        for (size_t i = 0; i < number_of_values; ++i) {
+            keys[i] = pairs[i].first;
+            values[i] = pairs[i].second;
+        }
+        return;
+    }
+
+    size_t number_of_chunks = (number_of_values + chunk_size - 1) / chunk_size;
+    std::vector<std::uint64_t> keys_buffer(number_of_values);
+    std::vector<Value> values_source(values, values + number_of_values);
+    std::vector<Value> values_buffer(number_of_values);
+    std::vector<size_t> positions(number_of_chunks * radix);
+
+    for (int shift = 0; shift < number_of_bits; shift += bits_per_digit) {
+        // Count the digits within each chunk
+        oneapi::tbb::parallel_for(size_t{0}, number_of_chunks, [&](size_t c) {
+            size_t *histogram = positions.data() + c * radix;
+            std::fill(histogram, histogram + radix, 0);
+            size_t end = std::min(number_of_values, (c + 1) * chunk_size);
+            for (size_t i = c * chunk_size; i < end; ++i) {
+                ++histogram[(keys[i] >> shift) & (radix - 1)];
+            }
+        });
+
+        // Turn the counts into the positions at which each chunk writes a digit, ordering by digit
+        // first and by chunk second keeps the sort stable
+        size_t offset = 0;
+        bool is_single_digit = false;
+        for (size_t d = 0; d < radix; ++d) {
+            size_t offset_of_digit = offset;
+            for (size_t c = 0; c < number_of_chunks; ++c) {
+                size_t count = positions[c * radix + d];
+                positions[c * radix + d] = offset;
+                offset += count;
+            }
+            is_single_digit = is_single_digit || offset - offset_of_digit == number_of_values;
+        }
+        if (is_single_digit) {
+            continue; // All keys share this digit, so the pass would not change the order
+        }
+
+        // Scatter the keys and values
+        oneapi::tbb::parallel_for(size_t{0}, number_of_chunks, [&](size_t c) {
+            size_t *position = positions.data() + c * radix;
+            size_t end = std::min(number_of_values, (c + 1) * chunk_size);
+            for (size_t i = c * chunk_size; i < end; ++i) {
+                size_t idx = position[(keys[i] >> shift) & (radix - 1)]++;
+                keys_buffer[idx] = keys[i];
+                values_buffer[idx] = values_source[i];
+            }
+        });
+        keys.swap(keys_buffer);
+        values_source.swap(values_buffer);
+    }
+
+    std::copy(values_source.begin(), values_source.end(), values);
+}
+
+} // namespace pairinteraction::sorting
@@ -2,6 +2,7 @@
 
 #include "pairinteraction/utils/eigen_assertion.hpp"
 
+#include <Eigen/Dense>
 #include <Eigen/SparseCore>
 #include <complex>
 #include <memory>
@@ -29,4 +30,52 @@ calculate_tensor_product(const std::shared_ptr<const BasisPair<std::complex<doub
                          const std::shared_ptr<const BasisPair<std::complex<double>>> &,
                          const Eigen::SparseMatrix<std::complex<double>, Eigen::RowMajor> &,
                          const Eigen::SparseMatrix<std::complex<double>, Eigen::RowMajor> &);
+
+/**
+ * @class TensorProductOperator
+ *
+ * @brief Lazy tensor product of two single-atom matrices.
+ *
+ * @details The operator represents matrix1 ⊗ matrix2, whose columns are restricted to the kets of
+ * a pair basis. Instead of constructing the product matrix, the operator is applied to vectors and
+ * sparse matrices directly by looping over the non-zero entries of the two factors. The rows of
+ * the result are either restricted to the kets of a second pair basis or span the full product
+ * space, ordered as row1 * matrix2.rows() + row2.
+ *
+ * The operator stores references to the matrices, which must outlive it.
+ */
+template <typename Scalar>
+class TensorProductOperator {
+public:
+    TensorProductOperator(std::shared_ptr<const BasisPair<Scalar>> basis_initial,
+                          const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix1,
+                          const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix2);
+
+    Eigen::VectorX<Scalar> apply(const std::shared_ptr<const BasisPair<Scalar>> &basis_final,
+                                 const Eigen::VectorX<Scalar> &vector) const;
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
+    apply(const std::shared_ptr<const BasisPair<Scalar>> &basis_final,
+          const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix) const;
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
+    apply(const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix) const;
+
+private:
+    std::shared_ptr<const BasisPair<Scalar>> basis_initial;
+    const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix1;
+    const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix2;
+
+    // Calls function(ket_index, value) for each non-zero entry of the row (row1, row2)
+    template <typename Function>
+    void for_each_entry_in_row(Eigen::Index row1, Eigen::Index row2, Function &&function) const;
+
+    // Applies the operator to the matrix, for_each_row(row1, function) must call function(row2,
+    // row) for each row of the result that belongs to the row1-th row of the first matrix
+    template <typename ForEachRow>
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
+    apply_to_rows(Eigen::Index number_of_rows, ForEachRow &&for_each_row,
+                  const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix) const;
+};
+
+extern template class TensorProductOperator<double>;
+extern template class TensorProductOperator<std::complex<double>>;
 } // namespace pairinteraction::utils
@@ -8,6 +8,7 @@
 #include <limits>
 #include <stdexcept>
 #include <type_traits>
+#include <vector>
 
 namespace pairinteraction::wigner {
 
@@ -34,6 +35,23 @@ inline Real wigner_uppercase_d_matrix_pi_half(Real f, Real m_initial, Real m_fin
 
 } // namespace
 
+template <typename Real>
+inline void check_wigner_uppercase_d_matrix_is_real(Real m_initial, Real m_final, Real alpha,
+                                                    Real gamma) {
+    static_assert(std::is_floating_point_v<Real>);
+
+    if (std::abs(std::remainder(m_initial * alpha, PI<Real>)) >
+        10 * std::numeric_limits<Real>::epsilon()) {
+        throw std::invalid_argument(
+            "The scalar type must be complex if m_initial*alpha is not a multiple of pi");
+    }
+    if (std::abs(std::remainder(m_final * gamma, PI<Real>)) >
+        10 * std::numeric_limits<Real>::epsilon()) {
+        throw std::invalid_argument(
+            "The scalar type must be complex if m_final*gamma is not a multiple of pi");
+    }
+}
+
 template <typename Scalar>
 inline Scalar wigner_uppercase_d_matrix(typename traits::NumTraits<Scalar>::real_t f,
                                         typename traits::NumTraits<Scalar>::real_t m_initial,
@@ -49,18 +67,7 @@ inline Scalar wigner_uppercase_d_matrix(typename traits::NumTraits<Scalar>::real
                    f, m_initial, m_final, 0, beta, 0) *
             Scalar(std::cos(-m_final * gamma), std::sin(-m_final * gamma));
     } else {
-        if (std::abs(
-                std::remainder(m_initial * alpha, PI<typename traits::NumTraits<Scalar>::real_t>)) >
-            10 * std::numeric_limits<typename traits::NumTraits<Scalar>::real_t>::epsilon()) {
-            throw std::invalid_argument(
-                "The scalar type must be complex if m_initial*alpha is not a multiple of pi");
-        }
-        if (std::abs(
-                std::remainder(m_final * gamma, PI<typename traits::NumTraits<Scalar>::real_t>)) >
-            10 * std::numeric_limits<typename traits::NumTraits<Scalar>::real_t>::epsilon()) {
-            throw std::invalid_argument(
-                "The scalar type must be complex if m_final*gamma is not a multiple of pi");
-        }
+        check_wigner_uppercase_d_matrix_is_real(m_initial, m_final, alpha, gamma);
         std::complex<Scalar> result = 0;
         for (typename traits::NumTraits<Scalar>::real_t m = -f; m <= f; ++m) {
             result += wigner_uppercase_d_matrix_pi_half(f, m_initial, m) *
@@ -75,4 +82,60 @@ inline Scalar wigner_uppercase_d_matrix(typename traits::NumTraits<Scalar>::real
     }
 }
 
+// Returns all entries of the Wigner D-matrix for the quantum number f, the entry for m_initial and
+// m_final is stored at the index (m_final + f) * (2 * f + 1) + (m_initial + f). The Wigner d-matrix
+// for pi/2 is calculated once and reused for all entries. For a real scalar type, the checks of
+// check_wigner_uppercase_d_matrix_is_real are not performed and must be done by the caller.
+template <typename Scalar>
+inline std::vector<Scalar>
+wigner_uppercase_d_matrix_block(typename traits::NumTraits<Scalar>::real_t f,
+                                typename traits::NumTraits<Scalar>::real_t alpha,
+                                typename traits::NumTraits<Scalar>::real_t beta,
+                                typename traits::NumTraits<Scalar>::real_t gamma) {
+    static_assert(traits::NumTraits<Scalar>::from_floating_point_v);
+    using real_t = typename traits::NumTraits<Scalar>::real_t;
+
+    auto dim = static_cast<size_t>(std::lround(2 * f)) + 1;
+    auto m_of = [&](size_t idx) { return static_cast<real_t>(idx) - f; };
+
+    std::vector<real_t> pi_half(dim * dim);
+    for (size_t i = 0; i < dim; ++i) {
+        for (size_t j = 0; j < dim; ++j) {
+            pi_half[i * dim + j] = wigner_uppercase_d_matrix_pi_half(f, m_of(i), m_of(j));
+        }
+    }
+
+    std::vector<std::complex<real_t>> phases(dim);
+    for (size_t k = 0; k < dim; ++k) {
+        phases[k] = std::complex<real_t>(std::cos(-m_of(k) * beta), std::sin(-m_of(k) * beta));
+    }
+
+    std::vector<Scalar> block(dim * dim);
+    for (size_t idx_initial = 0; idx_initial < dim; ++idx_initial) {
+        real_t m_initial = m_of(idx_initial);
+        for (size_t idx_final = 0; idx_final < dim; ++idx_final) {
+            real_t m_final = m_of(idx_final);
+
+            // The index of -m_final is dim - 1 - idx_final
+            std::complex<real_t> result = 0;
+            for (size_t k = 0; k < dim; ++k) {
+                result += pi_half[idx_initial * dim + k] * phases[k] *
+                    pi_half[k * dim + (dim - 1 - idx_final)];
+            }
+            result *= std::pow(std::complex<real_t>(0, 1), 2 * f - m_initial - m_final) *
+                static_cast<real_t>(std::pow(-1, 2 * m_initial));
+
+            if constexpr (traits::NumTraits<Scalar>::is_complex_v) {
+                block[idx_final * dim + idx_initial] =
+                    Scalar(std::cos(-m_initial * alpha), std::sin(-m_initial * alpha)) *
+                    result.real() * Scalar(std::cos(-m_final * gamma), std::sin(-m_final * gamma));
+            } else {
+                block[idx_final * dim + idx_initial] = result.real();
+            }
+        }
+    }
+
+    return block;
+}
+
 } // namespace pairinteraction::wigner
@@ -10,9 +10,13 @@
 #include "pairinteraction/ket/KetPair.hpp"
 #include "pairinteraction/utils/eigen_assertion.hpp"
 #include "pairinteraction/utils/eigen_compat.hpp"
+#include "pairinteraction/utils/sorting.hpp"
 #include "pairinteraction/utils/wigner.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <numeric>
+#include <oneapi/tbb.h>
 #include <set>
 
 namespace pairinteraction {
@@ -33,9 +37,7 @@ void Basis<Derived>::perform_sorter_checks(const std::vector<TransformationType>
 }
 
 template <typename Derived>
-void Basis<Derived>::perform_blocks_checks(
-    const std::set<TransformationType> &unique_labels) const {
-    // Check if the states are sorted by the requested labels
+bool Basis<Derived>::is_sorted_by(const std::set<TransformationType> &unique_labels) const {
     std::set<TransformationType> unique_labels_present;
     for (const auto &label : get_transformation().transformation_type) {
         if (!utils::is_sorting(label) || unique_labels_present.size() >= unique_labels.size()) {
@@ -43,7 +45,14 @@ void Basis<Derived>::perform_blocks_checks(
         }
         unique_labels_present.insert(label);
     }
-    if (unique_labels != unique_labels_present) {
+    return unique_labels == unique_labels_present;
+}
+
+template <typename Derived>
+void Basis<Derived>::perform_blocks_checks(
+    const std::set<TransformationType> &unique_labels) const {
+    // Check if the states are sorted by the requested labels
+    if (!is_sorted_by(unique_labels)) {
         throw std::invalid_argument("The states are not sorted by the requested labels.");
     }
 
@@ -57,52 +66,65 @@ void Basis<Derived>::perform_blocks_checks(
 
 template <typename Derived>
 Basis<Derived>::Basis(ketvec_t &&kets)
-    : kets(std::move(kets)), coefficients{{static_cast<Eigen::Index>(this->kets.size()),
-                                           static_cast<Eigen::Index>(this->kets.size())},
-                                          {TransformationType::SORT_BY_KET}} {
-    if (this->kets.empty()) {
+    : Basis(std::move(kets), {TransformationType::SORT_BY_KET}) {}
+
+template <typename Derived>
+Basis<Derived>::Basis(ketvec_t &&kets, std::vector<TransformationType> transformation_type) {
+    if (kets.empty()) {
         throw std::invalid_argument("The basis must contain at least one element.");
     }
-    state_index_to_quantum_number_f.reserve(this->kets.size());
-    state_index_to_quantum_number_m.reserve(this->kets.size());
-    state_index_to_parity.reserve(this->kets.size());
-    ket_to_ket_index.reserve(this->kets.size());
+
+    auto kets_of_basis = std::make_shared<KetData>();
+    auto states_of_basis = std::make_shared<StateData>();
+    auto number_of_kets = static_cast<Eigen::Index>(kets.size());
+    states_of_basis->coefficients = {{number_of_kets, number_of_kets},
+                                     std::move(transformation_type)};
+    states_of_basis->state_index_to_quantum_number_f.reserve(kets.size());
+    states_of_basis->state_index_to_quantum_number_m.reserve(kets.size());
+    states_of_basis->state_index_to_parity.reserve(kets.size());
+    states_of_basis->state_index_to_ket_index.reserve(kets.size());
+    states_of_basis->ket_index_to_state_index.reserve(kets.size());
+    kets_of_basis->ket_key_to_ket_index.reserve(kets.size());
     size_t index = 0;
-    for (const auto &ket : this->kets) {
-        state_index_to_quantum_number_f.push_back(ket->get_quantum_number_f());
-        state_index_to_quantum_number_m.push_back(ket->get_quantum_number_m());
-        state_index_to_parity.push_back(ket->get_parity());
-        ket_to_ket_index[ket] = index++;
+    for (const auto &ket : kets) {
+        states_of_basis->state_index_to_quantum_number_f.push_back(ket->get_quantum_number_f());
+        states_of_basis->state_index_to_quantum_number_m.push_back(ket->get_quantum_number_m());
+        states_of_basis->state_index_to_parity.push_back(ket->get_parity());
+        states_of_basis->state_index_to_ket_index.push_back(index);
+        states_of_basis->ket_index_to_state_index.emplace_back(index, index);
+        kets_of_basis->ket_key_to_ket_index.emplace_back(get_ket_key(*ket), index++);
         if (ket->get_quantum_number_f() == std::numeric_limits<real_t>::max()) {
-            _has_quantum_number_f = false;
+            states_of_basis->_has_quantum_number_f = false;
         }
         if (ket->get_quantum_number_m() == std::numeric_limits<real_t>::max()) {
-            _has_quantum_number_m = false;
+            states_of_basis->_has_quantum_number_m = false;
         }
         if (ket->get_parity() == Parity::UNKNOWN) {
-            _has_parity = false;
+            states_of_basis->_has_parity = false;
         }
     }
-    state_index_to_ket_index.resize(this->kets.size());
-    std::iota(state_index_to_ket_index.begin(), state_index_to_ket_index.end(), 0);
-    ket_index_to_state_index.resize(this->kets.size());
-    std::iota(ket_index_to_state_index.begin(), ket_index_to_state_index.end(), 0);
-    coefficients.matrix.setIdentity();
+    std::sort(kets_of_basis->ket_key_to_ket_index.begin(),
+              kets_of_basis->ket_key_to_ket_index.end());
+    states_of_basis->coefficients.matrix.setIdentity();
+    kets_of_basis->kets = std::move(kets);
+
+    ket_data = std::move(kets_of_basis);
+    state_data = std::move(states_of_basis);
 }
 
 template <typename Derived>
 bool Basis<Derived>::has_quantum_number_f() const {
-    return _has_quantum_number_f;
+    return state_data->_has_quantum_number_f;
 }
 
 template <typename Derived>
 bool Basis<Derived>::has_quantum_number_m() const {
-    return _has_quantum_number_m;
+    return state_data->_has_quantum_number_m;
 }
 
 template <typename Derived>
 bool Basis<Derived>::has_parity() const {
-    return _has_parity;
+    return state_data->_has_parity;
 }
 
 template <typename Derived>
@@ -112,27 +134,87 @@ const Derived &Basis<Derived>::derived() const {
 
 template <typename Derived>
 const typename Basis<Derived>::ketvec_t &Basis<Derived>::get_kets() const {
-    return kets;
+    return ket_data->kets;
 }
 
 template <typename Derived>
 const Eigen::SparseMatrix<typename Basis<Derived>::scalar_t, Eigen::RowMajor> &
 Basis<Derived>::get_coefficients() const {
-    return coefficients.matrix;
+    return state_data->coefficients.matrix;
 }
 
 template <typename Derived>
 Eigen::SparseMatrix<typename Basis<Derived>::scalar_t, Eigen::RowMajor> &
 Basis<Derived>::get_coefficients() {
-    return coefficients.matrix;
+    // Copy the states before they get modified because they might be shared with another basis.
+    // The states are always copied as checking use_count() would race with other threads that copy
+    // or release the shared states.
+    state_data = std::make_shared<StateData>(*state_data);
+    state_data->coefficients_by_column = std::make_shared<CoefficientsByColumn>();
+    return state_data->coefficients.matrix;
+}
+
+template <typename Derived>
+const Eigen::SparseMatrix<typename Basis<Derived>::scalar_t, Eigen::ColMajor> &
+Basis<Derived>::get_coefficients_by_column() const {
+    auto &by_column = *state_data->coefficients_by_column;
+    std::call_once(by_column.created,
+                   [&]() { by_column.matrix = state_data->coefficients.matrix; });
+    return by_column.matrix;
 }
 
 template <typename Derived>
 int Basis<Derived>::get_ket_index_from_ket(std::shared_ptr<const ket_t> ket) const {
-    if (ket_to_ket_index.count(ket) == 0) {
+    const auto &kets = ket_data->kets;
+    const auto &ket_key_to_ket_index = ket_data->ket_key_to_ket_index;
+    std::uint64_t key = get_ket_key(*ket);
+    auto it = std::lower_bound(ket_key_to_ket_index.begin(), ket_key_to_ket_index.end(),
+                               std::make_pair(key, size_t{0}));
+    for (; it != ket_key_to_ket_index.end() && it->first == key; ++it) {
+        if (kets[it->second] == ket || equal_to()(kets[it->second], ket)) {
+            return static_cast<int>(it->second);
+        }
+    }
+    return -1;
+}
+
+template <typename Derived>
+int Basis<Derived>::get_ket_index_for_different_quantum_number_m(
+    size_t ket_index, real_t new_quantum_number_m) const {
+    const auto &ket = ket_data->kets[ket_index];
+    if constexpr (std::is_same_v<ket_t, KetAtom>) {
+        // The ids in the database of kets that differ only in the quantum number m differ by the
+        // difference of 2*m, so that the ket can be looked up without creating it
+        const auto &ket_key_to_ket_index = ket_data->ket_key_to_ket_index;
+        auto key = static_cast<std::uint64_t>(
+            static_cast<std::int64_t>(ket->get_id_in_database()) +
+            std::lround(2 * new_quantum_number_m) - std::lround(2 * ket->get_quantum_number_m()));
+        auto it = std::lower_bound(ket_key_to_ket_index.begin(), ket_key_to_ket_index.end(),
+                                   std::make_pair(key, size_t{0}));
+        for (; it != ket_key_to_ket_index.end() && it->first == key; ++it) {
+            if (ket_data->kets[it->second]->get_species() == ket->get_species()) {
+                return static_cast<int>(it->second);
+            }
+        }
         return -1;
+    } else {
+        return get_ket_index_from_ket(
+            ket->get_ket_for_different_quantum_number_m(new_quantum_number_m));
+    }
+}
+
+template <typename Derived>
+size_t Basis<Derived>::get_state_index_from_ket_index(size_t ket_index) const {
+    if (ket_index >= ket_data->kets.size()) {
+        throw std::out_of_range("The ket index is out of range.");
+    }
+    const auto &ket_index_to_state_index = state_data->ket_index_to_state_index;
+    auto it = std::lower_bound(ket_index_to_state_index.begin(), ket_index_to_state_index.end(),
+                               std::make_pair(ket_index, size_t{0}));
+    if (it == ket_index_to_state_index.end() || it->first != ket_index) {
+        return std::numeric_limits<int>::max();
     }
-    return ket_to_ket_index.at(ket);
+    return it->second;
 }
 
 template <typename Derived>
@@ -144,13 +226,55 @@ Basis<Derived>::get_amplitudes(std::shared_ptr<const ket_t> ket) const {
     }
     // The following line is a more efficient alternative to
     // "get_amplitudes(get_canonical_state_from_ket(ket)).transpose()"
-    return coefficients.matrix.row(ket_index);
+    return state_data->coefficients.matrix.row(ket_index);
 }
 
 template <typename Derived>
 Eigen::SparseMatrix<typename Basis<Derived>::scalar_t, Eigen::RowMajor>
 Basis<Derived>::get_amplitudes(std::shared_ptr<const Derived> other) const {
-    return other->coefficients.matrix.adjoint() * coefficients.matrix;
+    return other->state_data->coefficients.matrix.adjoint() * state_data->coefficients.matrix;
+}
+
+template <typename Derived>
+Eigen::SparseMatrix<typename Basis<Derived>::scalar_t, Eigen::RowMajor>
+Basis<Derived>::get_amplitudes(const ketvec_t &kets) const {
+    using iterator_t = typename Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>::InnerIterator;
+    const auto &coefficients = state_data->coefficients.matrix;
+
+    // Look up the kets and count the amplitudes of each ket
+    std::vector<int> ket_indices(kets.size());
+    std::vector<int> outerIndexPtr(kets.size() + 1, 0);
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<size_t>(0, kets.size()), [&](const auto &range) {
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                ket_indices[i] = get_ket_index_from_ket(kets[i]);
+                if (ket_indices[i] < 0) {
+                    throw std::invalid_argument("One of the kets does not belong to the basis.");
+                }
+                for (iterator_t it(coefficients, ket_indices[i]); it; ++it) {
+                    outerIndexPtr[i + 1]++;
+                }
+            }
+        });
+    std::partial_sum(outerIndexPtr.begin(), outerIndexPtr.end(), outerIndexPtr.begin());
+
+    // Copy the rows of the coefficient matrix that belong to the kets
+    std::vector<int> innerIndices(outerIndexPtr.back());
+    std::vector<scalar_t> values(outerIndexPtr.back());
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<size_t>(0, kets.size()), [&](const auto &range) {
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                int idx = outerIndexPtr[i];
+                for (iterator_t it(coefficients, ket_indices[i]); it; ++it, ++idx) {
+                    innerIndices[idx] = static_cast<int>(it.col());
+                    values[idx] = it.value();
+                }
+            }
+        });
+
+    return Eigen::Map<const Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>>(
+        static_cast<Eigen::Index>(kets.size()), coefficients.cols(), values.size(),
+        outerIndexPtr.data(), innerIndices.data(), values.data());
 }
 
 template <typename Derived>
@@ -165,9 +289,15 @@ Basis<Derived>::get_overlaps(std::shared_ptr<const Derived> other) const {
     return get_amplitudes(other).cwiseAbs2();
 }
 
+template <typename Derived>
+Eigen::SparseMatrix<typename Basis<Derived>::real_t, Eigen::RowMajor>
+Basis<Derived>::get_overlaps(const ketvec_t &kets) const {
+    return get_amplitudes(kets).cwiseAbs2();
+}
+
 template <typename Derived>
 typename Basis<Derived>::real_t Basis<Derived>::get_quantum_number_f(size_t state_index) const {
-    real_t quantum_number_f = state_index_to_quantum_number_f.at(state_index);
+    real_t quantum_number_f = state_data->state_index_to_quantum_number_f.at(state_index);
     if (quantum_number_f == std::numeric_limits<real_t>::max()) {
         throw std::invalid_argument("The state does not have a well-defined quantum number f.");
     }
@@ -176,7 +306,7 @@ typename Basis<Derived>::real_t Basis<Derived>::get_quantum_number_f(size_t stat
 
 template <typename Derived>
 typename Basis<Derived>::real_t Basis<Derived>::get_quantum_number_m(size_t state_index) const {
-    real_t quantum_number_m = state_index_to_quantum_number_m.at(state_index);
+    real_t quantum_number_m = state_data->state_index_to_quantum_number_m.at(state_index);
     if (quantum_number_m == std::numeric_limits<real_t>::max()) {
         throw std::invalid_argument("The state does not have a well-defined quantum number m.");
     }
@@ -185,7 +315,7 @@ typename Basis<Derived>::real_t Basis<Derived>::get_quantum_number_m(size_t stat
 
 template <typename Derived>
 Parity Basis<Derived>::get_parity(size_t state_index) const {
-    Parity parity = state_index_to_parity.at(state_index);
+    Parity parity = state_data->state_index_to_parity.at(state_index);
     if (parity == Parity::UNKNOWN) {
         throw std::invalid_argument("The state does not have a well-defined parity.");
     }
@@ -195,11 +325,11 @@ Parity Basis<Derived>::get_parity(size_t state_index) const {
 template <typename Derived>
 std::shared_ptr<const typename Basis<Derived>::ket_t>
 Basis<Derived>::get_corresponding_ket(size_t state_index) const {
-    size_t ket_index = state_index_to_ket_index.at(state_index);
+    size_t ket_index = state_data->state_index_to_ket_index.at(state_index);
     if (ket_index == std::numeric_limits<int>::max()) {
         throw std::invalid_argument("The state does not belong to a ket in a well-defined way.");
     }
-    return kets[ket_index];
+    return ket_data->kets[ket_index];
 }
 
 template <typename Derived>
@@ -210,39 +340,162 @@ Basis<Derived>::get_corresponding_ket(std::shared_ptr<const Derived> /*state*/)
 
 template <typename Derived>
 std::shared_ptr<const Derived> Basis<Derived>::get_state(size_t state_index) const {
-    // Create a copy of the current object
+    const auto &states = *state_data;
+    if (state_index >= get_number_of_states()) {
+        throw std::out_of_range("The state index is out of range.");
+    }
+
+    // Create a copy of the current object, which shares the kets and states with this object
     auto restricted = std::make_shared<Derived>(derived());
 
-    // Restrict the copy to the state with the largest overlap
-    restricted->coefficients.matrix = restricted->coefficients.matrix.col(state_index);
+    // Restrict the copy to the state, gathering its coefficients from the column-major copy of
+    // the coefficients so that only the non-zero entries of the state are visited
+    const auto &by_column = get_coefficients_by_column();
+    std::vector<Eigen::Triplet<scalar_t>> triplets;
+    triplets.reserve(by_column.col(static_cast<Eigen::Index>(state_index)).nonZeros());
+    for (typename Eigen::SparseMatrix<scalar_t, Eigen::ColMajor>::InnerIterator it(
+             by_column, static_cast<Eigen::Index>(state_index));
+         it; ++it) {
+        triplets.emplace_back(it.row(), 0, it.value());
+    }
+    auto restricted_states = std::make_shared<StateData>();
+    restricted_states->coefficients.matrix.resize(by_column.rows(), 1);
+    restricted_states->coefficients.matrix.setFromTriplets(triplets.begin(), triplets.end());
+    restricted_states->coefficients.transformation_type = states.coefficients.transformation_type;
+
+    if (states.state_index_to_ket_index.at(state_index) != std::numeric_limits<int>::max()) {
+        restricted_states->ket_index_to_state_index = {
+            {states.state_index_to_ket_index[state_index], 0}};
+    }
+
+    restricted_states->state_index_to_quantum_number_f = {
+        states.state_index_to_quantum_number_f[state_index]};
+    restricted_states->state_index_to_quantum_number_m = {
+        states.state_index_to_quantum_number_m[state_index]};
+    restricted_states->state_index_to_parity = {states.state_index_to_parity[state_index]};
+    restricted_states->state_index_to_ket_index = {states.state_index_to_ket_index[state_index]};
+
+    restricted_states->_has_quantum_number_f =
+        restricted_states->state_index_to_quantum_number_f[0] != std::numeric_limits<real_t>::max();
+    restricted_states->_has_quantum_number_m =
+        restricted_states->state_index_to_quantum_number_m[0] != std::numeric_limits<real_t>::max();
+    restricted_states->_has_parity = restricted_states->state_index_to_parity[0] != Parity::UNKNOWN;
+
+    restricted->state_data = std::move(restricted_states);
+    return restricted;
+}
+
+template <typename Derived>
+std::shared_ptr<const Derived>
+Basis<Derived>::get_states(const std::vector<size_t> &state_indices) const {
+    using iterator_t = typename Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>::InnerIterator;
+    const auto &states = *state_data;
+    const auto &coefficients = states.coefficients.matrix;
+
+    // Map the selected states to the columns of the restricted coefficient matrix
+    std::vector<int> state_index_to_col(coefficients.cols(), -1);
+    for (size_t i = 0; i < state_indices.size(); ++i) {
+        if (state_indices[i] >= static_cast<size_t>(coefficients.cols())) {
+            throw std::out_of_range("The state index is out of range.");
+        }
+        if (state_index_to_col[state_indices[i]] >= 0) {
+            throw std::invalid_argument("The state indices must be unique.");
+        }
+        state_index_to_col[state_indices[i]] = static_cast<int>(i);
+    }
 
-    std::fill(restricted->ket_index_to_state_index.begin(),
-              restricted->ket_index_to_state_index.end(), std::numeric_limits<int>::max());
-    restricted->ket_index_to_state_index[state_index_to_ket_index[state_index]] = 0;
+    // Count the entries of each row that belong to the selected states
+    std::vector<int> outerIndexPtr(coefficients.rows() + 1, 0);
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<Eigen::Index>(0, coefficients.rows()), [&](const auto &range) {
+            for (Eigen::Index row = range.begin(); row != range.end(); ++row) {
+                for (iterator_t it(coefficients, row); it; ++it) {
+                    if (state_index_to_col[it.col()] >= 0) {
+                        outerIndexPtr[row + 1]++;
+                    }
+                }
+            }
+        });
+    std::partial_sum(outerIndexPtr.begin(), outerIndexPtr.end(), outerIndexPtr.begin());
+
+    // Copy the entries, keeping the columns of each row sorted
+    std::vector<int> innerIndices(outerIndexPtr.back());
+    std::vector<scalar_t> values(outerIndexPtr.back());
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<Eigen::Index>(0, coefficients.rows()), [&](const auto &range) {
+            std::vector<std::pair<int, scalar_t>> entries;
+            for (Eigen::Index row = range.begin(); row != range.end(); ++row) {
+                entries.clear();
+                for (iterator_t it(coefficients, row); it; ++it) {
+                    if (int col = state_index_to_col[it.col()]; col >= 0) {
+                        entries.emplace_back(col, it.value());
+                    }
+                }
+                std::sort(entries.begin(), entries.end(),
+                          [](const auto &a, const auto &b) { return a.first < b.first; });
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    innerIndices[outerIndexPtr[row] + i] = entries[i].first;
+                    values[outerIndexPtr[row] + i] = entries[i].second;
+                }
+            }
+        });
 
-    restricted->state_index_to_quantum_number_f = {state_index_to_quantum_number_f[state_index]};
-    restricted->state_index_to_quantum_number_m = {state_index_to_quantum_number_m[state_index]};
-    restricted->state_index_to_parity = {state_index_to_parity[state_index]};
-    restricted->state_index_to_ket_index = {state_index_to_ket_index[state_index]};
+    // Create a copy of the current object, which shares the kets with this object
+    auto restricted = std::make_shared<Derived>(derived());
 
-    restricted->_has_quantum_number_f =
-        restricted->state_index_to_quantum_number_f[0] != std::numeric_limits<real_t>::max();
-    restricted->_has_quantum_number_m =
-        restricted->state_index_to_quantum_number_m[0] != std::numeric_limits<real_t>::max();
-    restricted->_has_parity = restricted->state_index_to_parity[0] != Parity::UNKNOWN;
+    auto restricted_states = std::make_shared<StateData>();
+    restricted_states->coefficients.matrix =
+        Eigen::Map<const Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>>(
+            coefficients.rows(), static_cast<Eigen::Index>(state_indices.size()), values.size(),
+            outerIndexPtr.data(), innerIndices.data(), values.data());
+    restricted_states->coefficients.transformation_type = states.coefficients.transformation_type;
+
+    restricted_states->state_index_to_quantum_number_f.reserve(state_indices.size());
+    restricted_states->state_index_to_quantum_number_m.reserve(state_indices.size());
+    restricted_states->state_index_to_parity.reserve(state_indices.size());
+    restricted_states->state_index_to_ket_index.reserve(state_indices.size());
+    for (size_t i = 0; i < state_indices.size(); ++i) {
+        size_t state_index = state_indices[i];
+        restricted_states->state_index_to_quantum_number_f.push_back(
+            states.state_index_to_quantum_number_f[state_index]);
+        restricted_states->state_index_to_quantum_number_m.push_back(
+            states.state_index_to_quantum_number_m[state_index]);
+        restricted_states->state_index_to_parity.push_back(
+            states.state_index_to_parity[state_index]);
+        restricted_states->state_index_to_ket_index.push_back(
+            states.state_index_to_ket_index[state_index]);
+        if (states.state_index_to_ket_index[state_index] != std::numeric_limits<int>::max()) {
+            restricted_states->ket_index_to_state_index.emplace_back(
+                states.state_index_to_ket_index[state_index], i);
+        }
+        if (states.state_index_to_quantum_number_f[state_index] ==
+            std::numeric_limits<real_t>::max()) {
+            restricted_states->_has_quantum_number_f = false;
+        }
+        if (states.state_index_to_quantum_number_m[state_index] ==
+            std::numeric_limits<real_t>::max()) {
+            restricted_states->_has_quantum_number_m = false;
+        }
+        if (states.state_index_to_parity[state_index] == Parity::UNKNOWN) {
+            restricted_states->_has_parity = false;
+        }
+    }
+    std::sort(restricted_states->ket_index_to_state_index.begin(),
+              restricted_states->ket_index_to_state_index.end());
 
+    restricted->state_data = std::move(restricted_states);
     return restricted;
 }
 
 template <typename Derived>
 std::shared_ptr<const typename Basis<Derived>::ket_t>
 Basis<Derived>::get_ket(size_t ket_index) const {
-    return kets[ket_index];
+    return ket_data->kets[ket_index];
 }
 
 template <typename Derived>
 std::shared_ptr<const Derived> Basis<Derived>::get_corresponding_state(size_t ket_index) const {
-    size_t state_index = ket_index_to_state_index.at(ket_index);
+    size_t state_index = get_state_index_from_ket_index(ket_index);
     if (state_index == std::numeric_limits<int>::max()) {
         throw std::runtime_error("The ket does not belong to a state in a well-defined way.");
     }
@@ -261,7 +514,7 @@ Basis<Derived>::get_corresponding_state(std::shared_ptr<const ket_t> ket) const
 
 template <typename Derived>
 size_t Basis<Derived>::get_corresponding_state_index(size_t ket_index) const {
-    int state_index = ket_index_to_state_index.at(ket_index);
+    size_t state_index = get_state_index_from_ket_index(ket_index);
     if (state_index == std::numeric_limits<int>::max()) {
         throw std::runtime_error("The ket does not belong to a state in a well-defined way.");
     }
@@ -279,7 +532,7 @@ size_t Basis<Derived>::get_corresponding_state_index(std::shared_ptr<const ket_t
 
 template <typename Derived>
 size_t Basis<Derived>::get_corresponding_ket_index(size_t state_index) const {
-    int ket_index = state_index_to_ket_index.at(state_index);
+    int ket_index = state_data->state_index_to_ket_index.at(state_index);
     if (ket_index == std::numeric_limits<int>::max()) {
         throw std::runtime_error("The state does not belong to a ket in a well-defined way.");
     }
@@ -294,30 +547,34 @@ size_t Basis<Derived>::get_corresponding_ket_index(std::shared_ptr<const Derived
 template <typename Derived>
 std::shared_ptr<const Derived>
 Basis<Derived>::get_canonical_state_from_ket(size_t ket_index) const {
-    // Create a copy of the current object
+    const auto &kets = ket_data->kets;
+
+    // Create a copy of the current object, which shares the kets and states with this object
     auto created = std::make_shared<Derived>(derived());
 
     // Fill the copy with the state corresponding to the ket index
-    created->coefficients.matrix =
-        Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>(coefficients.matrix.rows(), 1);
-    created->coefficients.matrix.coeffRef(ket_index, 0) = 1;
-    created->coefficients.matrix.makeCompressed();
-
-    std::fill(created->ket_index_to_state_index.begin(), created->ket_index_to_state_index.end(),
-              std::numeric_limits<int>::max());
-    created->ket_index_to_state_index[ket_index] = 0;
-
-    created->state_index_to_quantum_number_f = {kets[ket_index]->get_quantum_number_f()};
-    created->state_index_to_quantum_number_m = {kets[ket_index]->get_quantum_number_m()};
-    created->state_index_to_parity = {kets[ket_index]->get_parity()};
-    created->state_index_to_ket_index = {ket_index};
-
-    created->_has_quantum_number_f =
-        created->state_index_to_quantum_number_f[0] != std::numeric_limits<real_t>::max();
-    created->_has_quantum_number_m =
-        created->state_index_to_quantum_number_m[0] != std::numeric_limits<real_t>::max();
-    created->_has_parity = created->state_index_to_parity[0] != Parity::UNKNOWN;
-
+    auto created_states = std::make_shared<StateData>();
+    created_states->coefficients.matrix = Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>(
+        state_data->coefficients.matrix.rows(), 1);
+    created_states->coefficients.matrix.coeffRef(ket_index, 0) = 1;
+    created_states->coefficients.matrix.makeCompressed();
+    created_states->coefficients.transformation_type =
+        state_data->coefficients.transformation_type;
+
+    created_states->ket_index_to_state_index = {{ket_index, 0}};
+
+    created_states->state_index_to_quantum_number_f = {kets[ket_index]->get_quantum_number_f()};
+    created_states->state_index_to_quantum_number_m = {kets[ket_index]->get_quantum_number_m()};
+    created_states->state_index_to_parity = {kets[ket_index]->get_parity()};
+    created_states->state_index_to_ket_index = {ket_index};
+
+    created_states->_has_quantum_number_f =
+        created_states->state_index_to_quantum_number_f[0] != std::numeric_limits<real_t>::max();
+    created_states->_has_quantum_number_m =
+        created_states->state_index_to_quantum_number_m[0] != std::numeric_limits<real_t>::max();
+    created_states->_has_parity = created_states->state_index_to_parity[0] != Parity::UNKNOWN;
+
+    created->state_data = std::move(created_states);
     return created;
 }
 
@@ -333,12 +590,12 @@ Basis<Derived>::get_canonical_state_from_ket(std::shared_ptr<const ket_t> ket) c
 
 template <typename Derived>
 typename Basis<Derived>::Iterator Basis<Derived>::begin() const {
-    return kets.begin();
+    return ket_data->kets.begin();
 }
 
 template <typename Derived>
 typename Basis<Derived>::Iterator Basis<Derived>::end() const {
-    return kets.end();
+    return ket_data->kets.end();
 }
 
 template <typename Derived>
@@ -362,41 +619,87 @@ typename Basis<Derived>::Iterator &Basis<Derived>::Iterator::operator++() {
 
 template <typename Derived>
 size_t Basis<Derived>::get_number_of_states() const {
-    return coefficients.matrix.cols();
+    return state_data->coefficients.matrix.cols();
 }
 
 template <typename Derived>
 size_t Basis<Derived>::get_number_of_kets() const {
-    return coefficients.matrix.rows();
+    return state_data->coefficients.matrix.rows();
 }
 
 template <typename Derived>
 const Transformation<typename Basis<Derived>::scalar_t> &
 Basis<Derived>::get_transformation() const {
-    return coefficients;
+    return state_data->coefficients;
 }
 
 template <typename Derived>
 Transformation<typename Basis<Derived>::scalar_t>
 Basis<Derived>::get_rotator(real_t alpha, real_t beta, real_t gamma) const {
+    const auto &kets = ket_data->kets;
+    const auto &coefficients = state_data->coefficients;
+
     Transformation<scalar_t> transformation{{static_cast<Eigen::Index>(coefficients.matrix.rows()),
                                              static_cast<Eigen::Index>(coefficients.matrix.rows())},
                                             {TransformationType::ROTATE}};
 
-    std::vector<Eigen::Triplet<scalar_t>> entries;
-
+    // Determine the position of the entries of each ket within the list of entries
+    std::vector<size_t> offsets(kets.size() + 1, 0);
+    std::vector<bool> is_f_present;
     for (size_t idx_initial = 0; idx_initial < kets.size(); ++idx_initial) {
         real_t f = kets[idx_initial]->get_quantum_number_f();
         real_t m_initial = kets[idx_initial]->get_quantum_number_m();
-        for (real_t m_final = -f; m_final <= f; ++m_final) {
-            auto val = wigner::wigner_uppercase_d_matrix<scalar_t>(f, m_initial, m_final, alpha,
-                                                                   beta, gamma);
-            size_t idx_final = get_ket_index_from_ket(
-                kets[idx_initial]->get_ket_for_different_quantum_number_m(m_final));
-            entries.emplace_back(idx_final, idx_initial, val);
+        if (f == std::numeric_limits<real_t>::max() ||
+            m_initial == std::numeric_limits<real_t>::max()) {
+            throw std::invalid_argument(
+                "The kets must have well-defined quantum numbers f and m to be rotated.");
+        }
+        auto twice_f = static_cast<size_t>(std::lround(2 * f));
+        if (twice_f >= is_f_present.size()) {
+            is_f_present.resize(twice_f + 1, false);
         }
+        is_f_present[twice_f] = true;
+        offsets[idx_initial + 1] = offsets[idx_initial] + twice_f + 1;
     }
 
+    // Calculate the Wigner D-matrix once for each quantum number f
+    std::vector<std::vector<scalar_t>> blocks(is_f_present.size());
+    oneapi::tbb::parallel_for(size_t{0}, blocks.size(), [&](size_t twice_f) {
+        if (is_f_present[twice_f]) {
+            blocks[twice_f] = wigner::wigner_uppercase_d_matrix_block<scalar_t>(
+                static_cast<real_t>(twice_f) / 2, alpha, beta, gamma);
+        }
+    });
+
+    // Assemble the entries of the rotator
+    std::vector<Eigen::Triplet<scalar_t>> entries(offsets.back());
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<size_t>(0, kets.size()), [&](const auto &range) {
+            for (size_t idx_initial = range.begin(); idx_initial != range.end(); ++idx_initial) {
+                real_t f = kets[idx_initial]->get_quantum_number_f();
+                real_t m_initial = kets[idx_initial]->get_quantum_number_m();
+                const auto &block = blocks[std::lround(2 * f)];
+                size_t dim = offsets[idx_initial + 1] - offsets[idx_initial];
+                auto idx_m_initial = static_cast<size_t>(std::lround(m_initial + f));
+                for (size_t idx_m_final = 0; idx_m_final < dim; ++idx_m_final) {
+                    real_t m_final = static_cast<real_t>(idx_m_final) - f;
+                    if constexpr (!traits::NumTraits<scalar_t>::is_complex_v) {
+                        wigner::check_wigner_uppercase_d_matrix_is_real(m_initial, m_final, alpha,
+                                                                        gamma);
+                    }
+                    int idx_final =
+                        get_ket_index_for_different_quantum_number_m(idx_initial, m_final);
+                    if (idx_final < 0) {
+                        throw std::invalid_argument("The basis must contain the kets for all "
+                                                    "quantum numbers m to be rotated.");
+                    }
+                    entries[offsets[idx_initial] + idx_m_final] = Eigen::Triplet<scalar_t>(
+                        idx_final, static_cast<int>(idx_initial),
+                        block[idx_m_final * dim + idx_m_initial]);
+                }
+            }
+        });
+
     transformation.matrix.setFromTriplets(entries.begin(), entries.end());
     transformation.matrix.makeCompressed();
 
@@ -416,7 +719,7 @@ Sorting Basis<Derived>::get_sorter(const std::vector<TransformationType> &labels
 
     // Initialize transformation
     Sorting transformation;
-    transformation.matrix.resize(coefficients.matrix.cols());
+    transformation.matrix.resize(state_data->coefficients.matrix.cols());
     transformation.matrix.setIdentity();
 
     // Get the sorter
@@ -439,7 +742,8 @@ Basis<Derived>::get_indices_of_blocks(const std::vector<TransformationType> &lab
     perform_blocks_checks(unique_labels);
 
     // Get the blocks
-    IndicesOfBlocksCreator blocks_creator({0, static_cast<size_t>(coefficients.matrix.cols())});
+    IndicesOfBlocksCreator blocks_creator(
+        {0, static_cast<size_t>(state_data->coefficients.matrix.cols())});
     get_indices_of_blocks_without_checks(unique_labels, blocks_creator);
 
     return blocks_creator.create();
@@ -448,44 +752,126 @@ Basis<Derived>::get_indices_of_blocks(const std::vector<TransformationType> &lab
 template <typename Derived>
 void Basis<Derived>::get_sorter_without_checks(const std::vector<TransformationType> &labels,
                                                Sorting &transformation) const {
-    constexpr real_t numerical_precision = 100 * std::numeric_limits<real_t>::epsilon();
+    const auto &coefficients = state_data->coefficients;
+    const auto &state_index_to_quantum_number_f = state_data->state_index_to_quantum_number_f;
+    const auto &state_index_to_quantum_number_m = state_data->state_index_to_quantum_number_m;
+    const auto &state_index_to_parity = state_data->state_index_to_parity;
+    const auto &state_index_to_ket_index = state_data->state_index_to_ket_index;
 
     int *perm_begin = transformation.matrix.indices().data();
     int *perm_end = perm_begin + coefficients.matrix.cols();
     int *perm_back = perm_end - 1;
 
-    // Sort the vector based on the requested labels
-    std::stable_sort(perm_begin, perm_end, [&](int a, int b) {
-        for (const auto &label : labels) {
-            switch (label) {
-            case TransformationType::SORT_BY_PARITY:
-                if (state_index_to_parity[a] != state_index_to_parity[b]) {
-                    return state_index_to_parity[a] < state_index_to_parity[b];
-                }
-                break;
-            case TransformationType::SORT_BY_QUANTUM_NUMBER_M:
-                if (std::abs(state_index_to_quantum_number_m[a] -
-                             state_index_to_quantum_number_m[b]) > numerical_precision) {
-                    return state_index_to_quantum_number_m[a] < state_index_to_quantum_number_m[b];
-                }
-                break;
-            case TransformationType::SORT_BY_QUANTUM_NUMBER_F:
-                if (std::abs(state_index_to_quantum_number_f[a] -
-                             state_index_to_quantum_number_f[b]) > numerical_precision) {
-                    return state_index_to_quantum_number_f[a] < state_index_to_quantum_number_f[b];
-                }
-                break;
-            case TransformationType::SORT_BY_KET:
-                if (state_index_to_ket_index[a] != state_index_to_ket_index[b]) {
-                    return state_index_to_ket_index[a] < state_index_to_ket_index[b];
-                }
-                break;
-            default:
-                std::abort(); // Can't happen because of previous checks
+    // Determine how each label is encoded into the bits of an integer key, so that comparing the
+    // keys compares the labels in the requested order. The quantum numbers are half-integers and
+    // are encoded as twice their value relative to their minimum, undefined labels as the largest
+    // code, which places them at the end like the sentinel values they are stored as.
+    struct Field {
+        TransformationType label;
+        std::int64_t offset;
+        int number_of_bits;
+    };
+    auto get_number_of_bits = [](std::uint64_t number_of_codes) {
+        int number_of_bits = 0;
+        while ((std::uint64_t{1} << number_of_bits) < number_of_codes) {
+            ++number_of_bits;
+        }
+        return number_of_bits;
+    };
+    auto get_range_of_twice = [](const std::vector<real_t> &values) {
+        std::int64_t min = std::numeric_limits<std::int64_t>::max();
+        std::int64_t max = std::numeric_limits<std::int64_t>::min();
+        for (real_t value : values) {
+            if (value != std::numeric_limits<real_t>::max()) {
+                min = std::min<std::int64_t>(min, std::llround(2 * value));
+                max = std::max<std::int64_t>(max, std::llround(2 * value));
             }
         }
-        return false; // Elements are equal
-    });
+        if (min > max) {
+            return std::make_pair(std::int64_t{0}, std::int64_t{0});
+        }
+        return std::make_pair(min, max);
+    };
+
+    std::vector<Field> fields;
+    int number_of_bits = 0;
+    for (const auto &label : labels) {
+        if (std::any_of(fields.begin(), fields.end(),
+                        [&](const Field &field) { return field.label == label; })) {
+            continue; // A repeated label can not change the order anymore
+        }
+        Field field{label, 0, 0};
+        switch (label) {
+        case TransformationType::SORT_BY_PARITY:
+            field.number_of_bits = get_number_of_bits(3);
+            break;
+        case TransformationType::SORT_BY_QUANTUM_NUMBER_M: {
+            auto [min, max] = get_range_of_twice(state_index_to_quantum_number_m);
+            field.offset = min;
+            field.number_of_bits = get_number_of_bits(max - min + 2);
+            break;
+        }
+        case TransformationType::SORT_BY_QUANTUM_NUMBER_F: {
+            auto [min, max] = get_range_of_twice(state_index_to_quantum_number_f);
+            field.offset = min;
+            field.number_of_bits = get_number_of_bits(max - min + 2);
+            break;
+        }
+        case TransformationType::SORT_BY_KET:
+            field.number_of_bits = get_number_of_bits(ket_data->kets.size() + 1);
+            break;
+        default:
+            std::abort(); // Can't happen because of previous checks
+        }
+        number_of_bits += field.number_of_bits;
+        fields.push_back(field);
+    }
+    if (number_of_bits >= 64) {
+        throw std::runtime_error("The labels of the states do not fit into a 64-bit sort key.");
+    }
+
+    // Encode the labels of the states, the first label occupies the most significant bits
+    auto encode = [&](const Field &field, int state_index) -> std::uint64_t {
+        switch (field.label) {
+        case TransformationType::SORT_BY_PARITY:
+            return state_index_to_parity[state_index] == Parity::ODD
+                ? 0
+                : (state_index_to_parity[state_index] == Parity::EVEN ? 1 : 2);
+        case TransformationType::SORT_BY_QUANTUM_NUMBER_M: {
+            real_t value = state_index_to_quantum_number_m[state_index];
+            return value == std::numeric_limits<real_t>::max()
+                ? (std::uint64_t{1} << field.number_of_bits) - 1
+                : static_cast<std::uint64_t>(std::llround(2 * value) - field.offset);
+        }
+        case TransformationType::SORT_BY_QUANTUM_NUMBER_F: {
+            real_t value = state_index_to_quantum_number_f[state_index];
+            return value == std::numeric_limits<real_t>::max()
+                ? (std::uint64_t{1} << field.number_of_bits) - 1
+                : static_cast<std::uint64_t>(std::llround(2 * value) - field.offset);
+        }
+        case TransformationType::SORT_BY_KET:
+            return state_index_to_ket_index[state_index] == std::numeric_limits<int>::max()
+                ? ket_data->kets.size()
+                : static_cast<std::uint64_t>(state_index_to_ket_index[state_index]);
+        default:
+            std::abort(); // Can't happen because of previous checks
+        }
+    };
+
+    std::vector<std::uint64_t> keys(perm_end - perm_begin);
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<size_t>(0, keys.size()), [&](const auto &range) {
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                std::uint64_t key = 0;
+                for (const auto &field : fields) {
+                    key = (key << field.number_of_bits) | encode(field, perm_begin[i]);
+                }
+                keys[i] = key;
+            }
+        });
+
+    // Sort the vector based on the keys
+    sorting::stable_sort_by_key(keys, perm_begin, number_of_bits);
 
     // Check for invalid values and add transformation types
     for (const auto &label : labels) {
@@ -530,6 +916,11 @@ template <typename Derived>
 void Basis<Derived>::get_indices_of_blocks_without_checks(
     const std::set<TransformationType> &unique_labels,
     IndicesOfBlocksCreator &blocks_creator) const {
+    const auto &coefficients = state_data->coefficients;
+    const auto &state_index_to_quantum_number_f = state_data->state_index_to_quantum_number_f;
+    const auto &state_index_to_quantum_number_m = state_data->state_index_to_quantum_number_m;
+    const auto &state_index_to_parity = state_data->state_index_to_parity;
+    const auto &state_index_to_ket_index = state_data->state_index_to_ket_index;
     constexpr real_t numerical_precision = 100 * std::numeric_limits<real_t>::epsilon();
 
     auto last_quantum_number_f = state_index_to_quantum_number_f[0];
@@ -572,34 +963,67 @@ void Basis<Derived>::get_indices_of_blocks_without_checks(
 
 template <typename Derived>
 std::shared_ptr<const Derived> Basis<Derived>::transformed(const Sorting &transformation) const {
-    // Create a copy of the current object
+    const auto &coefficients = state_data->coefficients;
+    const auto &state_index_to_quantum_number_f = state_data->state_index_to_quantum_number_f;
+    const auto &state_index_to_quantum_number_m = state_data->state_index_to_quantum_number_m;
+    const auto &state_index_to_parity = state_data->state_index_to_parity;
+    const auto &state_index_to_ket_index = state_data->state_index_to_ket_index;
+
+    // Create a copy of the current object, which shares the kets with this object
     auto transformed = std::make_shared<Derived>(derived());
+    auto transformed_states = std::make_shared<StateData>();
+    transformed_states->_has_quantum_number_f = state_data->_has_quantum_number_f;
+    transformed_states->_has_quantum_number_m = state_data->_has_quantum_number_m;
+    transformed_states->_has_parity = state_data->_has_parity;
 
     // Apply the transformation
-    transformed->coefficients.matrix = transformed->coefficients.matrix * transformation.matrix;
-    transformed->coefficients.transformation_type = transformation.transformation_type;
+    transformed_states->coefficients.matrix = coefficients.matrix * transformation.matrix;
+    transformed_states->coefficients.transformation_type = transformation.transformation_type;
 
-    transformed->state_index_to_quantum_number_f.resize(transformation.matrix.size());
-    transformed->state_index_to_quantum_number_m.resize(transformation.matrix.size());
-    transformed->state_index_to_parity.resize(transformation.matrix.size());
-    transformed->state_index_to_ket_index.resize(transformation.matrix.size());
+    transformed_states->state_index_to_quantum_number_f.resize(transformation.matrix.size());
+    transformed_states->state_index_to_quantum_number_m.resize(transformation.matrix.size());
+    transformed_states->state_index_to_parity.resize(transformation.matrix.size());
+    transformed_states->state_index_to_ket_index.resize(transformation.matrix.size());
 
     for (int i = 0; i < transformation.matrix.size(); ++i) {
-        transformed->state_index_to_quantum_number_f[i] =
+        transformed_states->state_index_to_quantum_number_f[i] =
             state_index_to_quantum_number_f[transformation.matrix.indices()[i]];
-        transformed->state_index_to_quantum_number_m[i] =
+        transformed_states->state_index_to_quantum_number_m[i] =
             state_index_to_quantum_number_m[transformation.matrix.indices()[i]];
-        transformed->state_index_to_parity[i] =
+        transformed_states->state_index_to_parity[i] =
             state_index_to_parity[transformation.matrix.indices()[i]];
-        transformed->state_index_to_ket_index[i] =
+        transformed_states->state_index_to_ket_index[i] =
             state_index_to_ket_index[transformation.matrix.indices()[i]];
-        transformed->ket_index_to_state_index
-            [state_index_to_ket_index[transformation.matrix.indices()[i]]] = i;
+        if (state_index_to_ket_index[transformation.matrix.indices()[i]] !=
+            std::numeric_limits<int>::max()) {
+            transformed_states->ket_index_to_state_index.emplace_back(
+                state_index_to_ket_index[transformation.matrix.indices()[i]], i);
+        }
     }
+    std::sort(transformed_states->ket_index_to_state_index.begin(),
+              transformed_states->ket_index_to_state_index.end());
 
+    transformed->state_data = std::move(transformed_states);
     return transformed;
 }
 
+template <typename Derived>
+std::shared_ptr<const Derived> Basis<Derived>::with_parities(std::vector<Parity> parities) const {
+    if (parities.size() != get_number_of_states()) {
+        throw std::invalid_argument("The number of parities must match the number of states.");
+    }
+
+    // Create a copy of the current object, which shares the kets with this object
+    auto relabeled = std::make_shared<Derived>(derived());
+    auto relabeled_states = std::make_shared<StateData>(*state_data);
+    relabeled_states->_has_parity = std::none_of(
+        parities.begin(), parities.end(), [](Parity p) { return p == Parity::UNKNOWN; });
+    relabeled_states->state_index_to_parity = std::move(parities);
+
+    relabeled->state_data = std::move(relabeled_states);
+    return relabeled;
+}
+
 template <typename Derived>
 std::shared_ptr<const Derived>
 Basis<Derived>::transformed(const Transformation<scalar_t> &transformation) const {
@@ -607,6 +1031,11 @@ Basis<Derived>::transformed(const Transformation<scalar_t> &transformation) cons
     // std::numeric_limits<real_t>::epsilon()" too small for figuring out whether m is conserved?
     real_t numerical_precision = 0.001;
 
+    const auto &coefficients = state_data->coefficients;
+    const auto &state_index_to_quantum_number_f = state_data->state_index_to_quantum_number_f;
+    const auto &state_index_to_quantum_number_m = state_data->state_index_to_quantum_number_m;
+    const auto &state_index_to_parity = state_data->state_index_to_parity;
+
     // If the transformation is a rotation, it should be a rotation and nothing else
     bool is_rotation = false;
     for (auto t : transformation.transformation_type) {
@@ -630,85 +1059,99 @@ Basis<Derived>::transformed(const Transformation<scalar_t> &transformation) cons
         }
     }
 
-    // Create a copy of the current object
+    // Create a copy of the current object, which shares the kets with this object
     auto transformed = std::make_shared<Derived>(derived());
+    auto transformed_states = std::make_shared<StateData>();
+    transformed_states->_has_quantum_number_f = state_data->_has_quantum_number_f;
+    transformed_states->_has_quantum_number_m = state_data->_has_quantum_number_m;
+    transformed_states->_has_parity = state_data->_has_parity;
 
     // Apply the transformation
     // If a quantum number turns out to be conserved by the transformation, it will be
     // rounded to the nearest half integer to avoid loss of numerical_precision.
-    transformed->coefficients.matrix = coefficients.matrix * transformation.matrix;
-    transformed->coefficients.transformation_type = transformation.transformation_type;
+    transformed_states->coefficients.matrix = coefficients.matrix * transformation.matrix;
+    transformed_states->coefficients.transformation_type = transformation.transformation_type;
+
+    // Propagate the quantum numbers f and m and the parity in a single pass over the columns of
+    // the transformation. A label of a new state is conserved if its variance, calculated from
+    // the probabilities |T_ji|^2 of the old states j, vanishes.
+    Eigen::SparseMatrix<scalar_t, Eigen::ColMajor> transformation_by_column = transformation.matrix;
+    auto number_of_transformed_states = static_cast<size_t>(transformation_by_column.cols());
+    transformed_states->state_index_to_quantum_number_f.resize(number_of_transformed_states);
+    transformed_states->state_index_to_quantum_number_m.resize(number_of_transformed_states);
+    transformed_states->state_index_to_parity.resize(number_of_transformed_states);
+    std::atomic<bool> has_quantum_number_f = transformed_states->_has_quantum_number_f;
+    std::atomic<bool> has_quantum_number_m = transformed_states->_has_quantum_number_m;
+    std::atomic<bool> has_parity = transformed_states->_has_parity;
+
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<size_t>(0, number_of_transformed_states),
+        [&](const auto &range) {
+            using utype = std::underlying_type<Parity>::type;
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                real_t f_val = 0;
+                real_t f_sq = 0;
+                real_t m_val = 0;
+                real_t m_sq = 0;
+                real_t p_val = 0;
+                real_t p_sq = 0;
+                for (typename Eigen::SparseMatrix<scalar_t, Eigen::ColMajor>::InnerIterator it(
+                         transformation_by_column, static_cast<int>(i));
+                     it; ++it) {
+                    real_t prob = std::norm(it.value());
+                    real_t f = state_index_to_quantum_number_f[it.row()];
+                    real_t m = state_index_to_quantum_number_m[it.row()];
+                    auto parity = static_cast<real_t>(
+                        static_cast<utype>(state_index_to_parity[it.row()]));
+                    f_val += prob * f;
+                    f_sq += prob * f * f;
+                    m_val += prob * m;
+                    m_sq += prob * m * m;
+                    p_val += prob * parity;
+                    p_sq += prob * parity * parity;
+                }
 
-    Eigen::SparseMatrix<real_t> probs = transformation.matrix.cwiseAbs2().transpose();
+                if (std::abs(f_val * f_val - f_sq) < numerical_precision) {
+                    transformed_states->state_index_to_quantum_number_f[i] =
+                        std::round(f_val * 2) / 2;
+                } else {
+                    transformed_states->state_index_to_quantum_number_f[i] =
+                        std::numeric_limits<real_t>::max();
+                    has_quantum_number_f.store(false, std::memory_order_relaxed);
+                }
 
-    {
-        auto map = Eigen::Map<const Eigen::VectorX<real_t>>(state_index_to_quantum_number_f.data(),
-                                                            state_index_to_quantum_number_f.size());
-        Eigen::VectorX<real_t> val = probs * map;
-        Eigen::VectorX<real_t> sq = probs * map.cwiseAbs2();
-        Eigen::VectorX<real_t> diff = (val.cwiseAbs2() - sq).cwiseAbs();
-        transformed->state_index_to_quantum_number_f.resize(probs.rows());
-
-        for (size_t i = 0; i < transformed->state_index_to_quantum_number_f.size(); ++i) {
-            if (diff[i] < numerical_precision) {
-                transformed->state_index_to_quantum_number_f[i] = std::round(val[i] * 2) / 2;
-            } else {
-                transformed->state_index_to_quantum_number_f[i] =
-                    std::numeric_limits<real_t>::max();
-                transformed->_has_quantum_number_f = false;
-            }
-        }
-    }
+                if (std::abs(m_val * m_val - m_sq) < numerical_precision) {
+                    transformed_states->state_index_to_quantum_number_m[i] =
+                        std::round(m_val * 2) / 2;
+                } else {
+                    transformed_states->state_index_to_quantum_number_m[i] =
+                        std::numeric_limits<real_t>::max();
+                    has_quantum_number_m.store(false, std::memory_order_relaxed);
+                }
 
-    {
-        auto map = Eigen::Map<const Eigen::VectorX<real_t>>(state_index_to_quantum_number_m.data(),
-                                                            state_index_to_quantum_number_m.size());
-        Eigen::VectorX<real_t> val = probs * map;
-        Eigen::VectorX<real_t> sq = probs * map.cwiseAbs2();
-        Eigen::VectorX<real_t> diff = (val.cwiseAbs2() - sq).cwiseAbs();
-        transformed->state_index_to_quantum_number_m.resize(probs.rows());
-
-        for (size_t i = 0; i < transformed->state_index_to_quantum_number_m.size(); ++i) {
-            if (diff[i] < numerical_precision) {
-                transformed->state_index_to_quantum_number_m[i] = std::round(val[i] * 2) / 2;
-            } else {
-                transformed->state_index_to_quantum_number_m[i] =
-                    std::numeric_limits<real_t>::max();
-                transformed->_has_quantum_number_m = false;
+                if (std::abs(p_val * p_val - p_sq) < numerical_precision) {
+                    transformed_states->state_index_to_parity[i] =
+                        static_cast<Parity>(std::lround(p_val));
+                } else {
+                    transformed_states->state_index_to_parity[i] = Parity::UNKNOWN;
+                    has_parity.store(false, std::memory_order_relaxed);
+                }
             }
-        }
-    }
+        });
 
-    {
-        using utype = std::underlying_type<Parity>::type;
-        Eigen::VectorX<real_t> map(state_index_to_parity.size());
-        for (size_t i = 0; i < state_index_to_parity.size(); ++i) {
-            map[i] = static_cast<utype>(state_index_to_parity[i]);
-        }
-        Eigen::VectorX<real_t> val = probs * map;
-        Eigen::VectorX<real_t> sq = probs * map.cwiseAbs2();
-        Eigen::VectorX<real_t> diff = (val.cwiseAbs2() - sq).cwiseAbs();
-        transformed->state_index_to_parity.resize(probs.rows());
-
-        for (size_t i = 0; i < transformed->state_index_to_parity.size(); ++i) {
-            if (diff[i] < numerical_precision) {
-                transformed->state_index_to_parity[i] = static_cast<Parity>(std::lround(val[i]));
-            } else {
-                transformed->state_index_to_parity[i] = Parity::UNKNOWN;
-                transformed->_has_parity = false;
-            }
-        }
-    }
+    transformed_states->_has_quantum_number_f = has_quantum_number_f;
+    transformed_states->_has_quantum_number_m = has_quantum_number_m;
+    transformed_states->_has_parity = has_parity;
 
     {
         // In the following, we obtain a bijective map between state index and ket index.
 
         // Find the maximum value in each row and column
-        std::vector<real_t> max_in_row(transformed->coefficients.matrix.rows(), 0);
-        std::vector<real_t> max_in_col(transformed->coefficients.matrix.cols(), 0);
-        for (int row = 0; row < transformed->coefficients.matrix.outerSize(); ++row) {
+        std::vector<real_t> max_in_row(transformed_states->coefficients.matrix.rows(), 0);
+        std::vector<real_t> max_in_col(transformed_states->coefficients.matrix.cols(), 0);
+        for (int row = 0; row < transformed_states->coefficients.matrix.outerSize(); ++row) {
             for (typename Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>::InnerIterator it(
-                     transformed->coefficients.matrix, row);
+                     transformed_states->coefficients.matrix, row);
                  it; ++it) {
                 real_t val = std::pow(std::abs(it.value()), 2);
                 max_in_row[row] = std::max(max_in_row[row], val);
@@ -719,11 +1162,11 @@ Basis<Derived>::transformed(const Transformation<scalar_t> &transformation) cons
         // Use the maximum values to define a cost for a sub-optimal mapping
         std::vector<real_t> costs;
         std::vector<std::pair<int, int>> mappings;
-        costs.reserve(transformed->coefficients.matrix.nonZeros());
-        mappings.reserve(transformed->coefficients.matrix.nonZeros());
-        for (int row = 0; row < transformed->coefficients.matrix.outerSize(); ++row) {
+        costs.reserve(transformed_states->coefficients.matrix.nonZeros());
+        mappings.reserve(transformed_states->coefficients.matrix.nonZeros());
+        for (int row = 0; row < transformed_states->coefficients.matrix.outerSize(); ++row) {
             for (typename Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>::InnerIterator it(
-                     transformed->coefficients.matrix, row);
+                     transformed_states->coefficients.matrix, row);
                  it; ++it) {
                 real_t val = std::pow(std::abs(it.value()), 2);
                 real_t cost = max_in_row[row] + max_in_col[it.col()] - 2 * val;
@@ -738,13 +1181,12 @@ Basis<Derived>::transformed(const Transformation<scalar_t> &transformation) cons
         std::sort(order.begin(), order.end(),
                   [&](size_t a, size_t b) { return costs[a] < costs[b]; });
 
-        // Fill ket_index_to_state_index with invalid values as there can be more kets than states
-        std::fill(transformed->ket_index_to_state_index.begin(),
-                  transformed->ket_index_to_state_index.end(), std::numeric_limits<int>::max());
-
-        // Generate the bijective map
-        std::vector<bool> row_used(transformed->coefficients.matrix.rows(), false);
-        std::vector<bool> col_used(transformed->coefficients.matrix.cols(), false);
+        // Generate the bijective map, there can be more kets than states
+        auto number_of_states = transformed_states->coefficients.matrix.cols();
+        transformed_states->state_index_to_ket_index.resize(number_of_states);
+        transformed_states->ket_index_to_state_index.reserve(number_of_states);
+        std::vector<bool> row_used(transformed_states->coefficients.matrix.rows(), false);
+        std::vector<bool> col_used(transformed_states->coefficients.matrix.cols(), false);
         int num_used = 0;
         for (size_t idx : order) {
             int row = mappings[idx].first;  // corresponds to the ket index
@@ -753,22 +1195,36 @@ Basis<Derived>::transformed(const Transformation<scalar_t> &transformation) cons
                 row_used[row] = true;
                 col_used[col] = true;
                 num_used++;
-                transformed->state_index_to_ket_index[col] = row;
-                transformed->ket_index_to_state_index[row] = col;
+                transformed_states->state_index_to_ket_index[col] = row;
+                transformed_states->ket_index_to_state_index.emplace_back(row, col);
             }
-            if (num_used == transformed->coefficients.matrix.cols()) {
+            if (num_used == transformed_states->coefficients.matrix.cols()) {
                 break;
             }
         }
-        assert(num_used == transformed->coefficients.matrix.cols());
+        assert(num_used == transformed_states->coefficients.matrix.cols());
+        std::sort(transformed_states->ket_index_to_state_index.begin(),
+                  transformed_states->ket_index_to_state_index.end());
     }
 
+    transformed->state_data = std::move(transformed_states);
     return transformed;
 }
 
 template <typename Derived>
-size_t Basis<Derived>::hash::operator()(const std::shared_ptr<const ket_t> &k) const {
-    return typename ket_t::hash()(*k);
+std::uint64_t Basis<Derived>::get_ket_key(const ket_t &ket) {
+    if constexpr (std::is_same_v<ket_t, KetAtom>) {
+        return ket.get_id_in_database();
+    } else if constexpr (std::is_same_v<ket_t, KetPair<scalar_t>>) {
+        const auto &atomic_indices = ket.get_atomic_indices();
+        std::uint64_t key = 0;
+        for (const auto &index : atomic_indices) {
+            key = (key << 32) ^ index;
+        }
+        return key;
+    } else {
+        return typename ket_t::hash()(ket);
+    }
 }
 
 template <typename Derived>
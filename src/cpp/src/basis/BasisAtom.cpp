@@ -3,15 +3,24 @@
 #include "pairinteraction/database/Database.hpp"
 #include "pairinteraction/ket/KetAtom.hpp"
 
+#include <atomic>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <vector>
+
 namespace pairinteraction {
 template <typename Scalar>
 BasisAtom<Scalar>::BasisAtom(Private /*unused*/, ketvec_t &&kets, std::string &&id_of_kets,
                              Database &database)
     : Basis<BasisAtom<Scalar>>(std::move(kets)), id_of_kets(std::move(id_of_kets)),
       database(database) {
-    for (size_t i = 0; i < this->kets.size(); ++i) {
-        ket_id_to_ket_index[this->kets[i]->get_id_in_database()] = i;
+    std::unordered_map<size_t, size_t> map;
+    map.reserve(this->get_number_of_kets());
+    for (size_t i = 0; i < this->get_number_of_kets(); ++i) {
+        map[this->get_ket(i)->get_id_in_database()] = i;
     }
+    ket_id_to_ket_index =
+        std::make_shared<const std::unordered_map<size_t, size_t>>(std::move(map));
 }
 
 template <typename Scalar>
@@ -21,15 +30,16 @@ Database &BasisAtom<Scalar>::get_database() const {
 
 template <typename Scalar>
 const std::string &BasisAtom<Scalar>::get_species() const {
-    return this->kets[0]->get_species();
+    return this->get_ket(0)->get_species();
 }
 
 template <typename Scalar>
 int BasisAtom<Scalar>::get_ket_index_from_id(size_t ket_id) const {
-    if (ket_id_to_ket_index.count(ket_id) == 0) {
+    auto it = ket_id_to_ket_index->find(ket_id);
+    if (it == ket_id_to_ket_index->end()) {
         return -1;
     }
-    return ket_id_to_ket_index.at(ket_id);
+    return static_cast<int>(it->second);
 }
 
 template <typename Scalar>
@@ -37,6 +47,34 @@ const std::string &BasisAtom<Scalar>::get_id_of_kets() const {
     return id_of_kets;
 }
 
+template <typename Scalar>
+std::shared_ptr<const BasisAtom<Scalar>>
+BasisAtom<Scalar>::restricted(const std::vector<size_t> &ket_indices) const {
+    static std::atomic<size_t> number_of_restrictions{0};
+
+    ketvec_t restricted_kets;
+    restricted_kets.reserve(ket_indices.size());
+    std::vector<bool> is_used(this->get_number_of_kets(), false);
+    for (size_t index : ket_indices) {
+        if (index >= this->get_number_of_kets()) {
+            throw std::invalid_argument("The ket index is out of range.");
+        }
+        if (is_used[index]) {
+            throw std::invalid_argument("The ket indices must be unique.");
+        }
+        is_used[index] = true;
+        restricted_kets.push_back(this->get_ket(index));
+    }
+
+    std::string restricted_id_of_kets =
+        fmt::format("{}_restricted_{}", id_of_kets, number_of_restrictions++);
+    auto basis = std::make_shared<Type>(Private(), std::move(restricted_kets),
+                                        std::move(restricted_id_of_kets), database);
+    basis->parent_basis = this->shared_from_this();
+    basis->parent_ket_indices = std::make_shared<const std::vector<size_t>>(ket_indices);
+    return basis;
+}
+
 template <typename Scalar>
 Eigen::VectorX<Scalar> BasisAtom<Scalar>::get_matrix_elements(std::shared_ptr<const ket_t> ket,
                                                               OperatorType type, int q) const {
@@ -1,5 +1,6 @@
 #include "pairinteraction/basis/BasisAtomCreator.hpp"
 
+#include "pairinteraction/basis/BasisAtom.hpp"
 #include "pairinteraction/database/AtomDescriptionByRanges.hpp"
 #include "pairinteraction/database/Database.hpp"
 #include "pairinteraction/enums/Parity.hpp"
@@ -111,6 +112,13 @@ BasisAtomCreator<Scalar>::append_ket(const std::shared_ptr<const ket_t> &ket) {
     return *this;
 }
 
+template <typename Scalar>
+BasisAtomCreator<Scalar> &
+BasisAtomCreator<Scalar>::extend_basis(std::shared_ptr<const BasisAtom<Scalar>> basis) {
+    basis_to_extend = std::move(basis);
+    return *this;
+}
+
 template <typename Scalar>
 std::shared_ptr<const BasisAtom<Scalar>>
 BasisAtomCreator<Scalar>::create(Database &database) const {
@@ -125,6 +133,8 @@ BasisAtomCreator<Scalar>::create(Database &database) const {
         extracted_species = species.value();
     } else if (additional_ket_species.has_value()) {
         extracted_species = additional_ket_species.value();
+    } else if (basis_to_extend) {
+        extracted_species = basis_to_extend->get_species();
     } else {
         throw std::runtime_error("Species not set.");
     }
@@ -142,6 +152,13 @@ BasisAtomCreator<Scalar>::create(Database &database) const {
                                         range_quantum_number_l_ryd,
                                         range_quantum_number_j_ryd};
 
+    if (basis_to_extend) {
+        if (extracted_species != basis_to_extend->get_species()) {
+            throw std::invalid_argument("Species mismatch.");
+        }
+        return database.extend_basis<Scalar>(basis_to_extend, description, additional_ket_ids);
+    }
+
     return database.get_basis<Scalar>(extracted_species, description, additional_ket_ids);
 }
 
@@ -109,6 +109,141 @@ DOCTEST_TEST_CASE("create a basis and sort it according to parity and m") {
     DOCTEST_CHECK(transformation.transformation_type.back() == TransformationType::ARBITRARY);
 }
 
+DOCTEST_TEST_CASE("get states of a sorted basis") {
+    Database &database = Database::get_global_instance();
+    auto basis_unsorted = BasisAtomCreator<double>()
+                              .set_species("Rb")
+                              .restrict_quantum_number_n(60, 60)
+                              .restrict_quantum_number_l(0, 3)
+                              .create(database);
+    auto sorter = basis_unsorted->get_sorter({TransformationType::SORT_BY_QUANTUM_NUMBER_M});
+    auto basis = basis_unsorted->transformed(sorter);
+
+    for (size_t state_index = 0; state_index < basis->get_number_of_states(); ++state_index) {
+        auto state = basis->get_state(state_index);
+        DOCTEST_CHECK(state->get_number_of_states() == 1);
+        DOCTEST_CHECK(state->get_number_of_kets() == basis->get_number_of_kets());
+        DOCTEST_CHECK(state->get_quantum_number_m(0) == basis->get_quantum_number_m(state_index));
+
+        // The kets are shared and the mapping between states and kets is restricted to the state
+        size_t ket_index = basis->get_corresponding_ket_index(state_index);
+        DOCTEST_CHECK(state->get_ket(ket_index) == basis->get_ket(ket_index));
+        DOCTEST_CHECK(basis->get_corresponding_state_index(ket_index) == state_index);
+        DOCTEST_CHECK(state->get_corresponding_state_index(ket_index) == 0);
+        DOCTEST_CHECK(state->get_coefficients().coeff(static_cast<Eigen::Index>(ket_index), 0) ==
+                      basis->get_coefficients().coeff(static_cast<Eigen::Index>(ket_index),
+                                                      static_cast<Eigen::Index>(state_index)));
+        Eigen::VectorXd column =
+            basis->get_coefficients().col(static_cast<Eigen::Index>(state_index));
+        DOCTEST_CHECK((Eigen::VectorXd(state->get_coefficients()) - column).norm() == 0);
+    }
+
+    // Modifying the coefficients of a copy does not affect the original basis
+    auto copy = std::make_shared<BasisAtom<double>>(*basis);
+    copy->get_coefficients() *= 2;
+    DOCTEST_CHECK((copy->get_coefficients() - 2 * basis->get_coefficients()).norm() == 0);
+    DOCTEST_CHECK((copy->get_state(0)->get_coefficients() -
+                   2 * basis->get_state(0)->get_coefficients())
+                      .norm() == 0);
+}
+
+DOCTEST_TEST_CASE("get several states and amplitudes at once") {
+    Database &database = Database::get_global_instance();
+    auto basis_unsorted = BasisAtomCreator<double>()
+                              .set_species("Rb")
+                              .restrict_quantum_number_n(60, 60)
+                              .restrict_quantum_number_l(0, 3)
+                              .create(database);
+    auto sorter = basis_unsorted->get_sorter({TransformationType::SORT_BY_QUANTUM_NUMBER_M});
+    auto basis = basis_unsorted->transformed(sorter);
+
+    std::vector<size_t> state_indices = {5, 0, 3};
+    auto states = basis->get_states(state_indices);
+    DOCTEST_REQUIRE(states->get_number_of_states() == state_indices.size());
+    for (size_t i = 0; i < state_indices.size(); ++i) {
+        auto state = basis->get_state(state_indices[i]);
+        DOCTEST_CHECK((states->get_coefficients().col(static_cast<Eigen::Index>(i)) -
+                       state->get_coefficients().col(0))
+                          .norm() == 0);
+        DOCTEST_CHECK(states->get_quantum_number_m(i) ==
+                      basis->get_quantum_number_m(state_indices[i]));
+    }
+    DOCTEST_CHECK_THROWS_AS(basis->get_states({0, 0}), std::invalid_argument);
+
+    std::vector<std::shared_ptr<const KetAtom>> kets = {basis->get_ket(2), basis->get_ket(1)};
+    Eigen::MatrixXd amplitudes = basis->get_amplitudes(kets);
+    DOCTEST_REQUIRE(amplitudes.rows() == 2);
+    for (size_t i = 0; i < kets.size(); ++i) {
+        DOCTEST_CHECK((amplitudes.row(static_cast<Eigen::Index>(i)).transpose() -
+                       basis->get_amplitudes(kets[i]))
+                          .norm() == 0);
+    }
+}
+
+DOCTEST_TEST_CASE("extend a basis and reuse its matrix elements") {
+    auto &database = Database::get_global_instance();
+
+    auto basis_small = BasisAtomCreator<double>()
+                           .set_species("Rb")
+                           .restrict_quantum_number_n(60, 60)
+                           .restrict_quantum_number_l(0, 1)
+                           .create(database);
+    database.get_matrix_elements<double>(basis_small, basis_small, OperatorType::ELECTRIC_DIPOLE,
+                                         0);
+
+    auto basis_extended = BasisAtomCreator<double>()
+                              .restrict_quantum_number_n(59, 61)
+                              .restrict_quantum_number_l(0, 1)
+                              .extend_basis(basis_small)
+                              .create(database);
+    auto basis_reference = BasisAtomCreator<double>()
+                               .set_species("Rb")
+                               .restrict_quantum_number_n(59, 61)
+                               .restrict_quantum_number_l(0, 1)
+                               .create(database);
+    DOCTEST_REQUIRE(basis_extended->get_number_of_kets() ==
+                    basis_reference->get_number_of_kets());
+
+    Eigen::MatrixXd extended = database.get_matrix_elements<double>(
+        basis_extended, basis_extended, OperatorType::ELECTRIC_DIPOLE, 0);
+    Eigen::MatrixXd reference = database.get_matrix_elements<double>(
+        basis_reference, basis_reference, OperatorType::ELECTRIC_DIPOLE, 0);
+
+    DOCTEST_CHECK((extended - reference).norm() <= 1e-12 * reference.norm());
+}
+
+DOCTEST_TEST_CASE("restrict a basis and slice its matrix elements") {
+    auto &database = Database::get_global_instance();
+
+    auto basis = BasisAtomCreator<double>()
+                     .set_species("Rb")
+                     .restrict_quantum_number_n(59, 61)
+                     .restrict_quantum_number_l(0, 1)
+                     .create(database);
+    Eigen::MatrixXd parent = database.get_matrix_elements<double>(
+        basis, basis, OperatorType::ELECTRIC_DIPOLE, 0);
+
+    std::vector<size_t> ket_indices;
+    for (size_t i = 0; i < basis->get_number_of_kets(); i += 2) {
+        ket_indices.push_back(i);
+    }
+    auto basis_restricted = basis->restricted(ket_indices);
+    DOCTEST_REQUIRE(basis_restricted->get_number_of_kets() == ket_indices.size());
+
+    Eigen::MatrixXd restricted = database.get_matrix_elements<double>(
+        basis_restricted, basis_restricted, OperatorType::ELECTRIC_DIPOLE, 0);
+    for (size_t i = 0; i < ket_indices.size(); ++i) {
+        DOCTEST_CHECK(basis_restricted->get_ket(i) == basis->get_ket(ket_indices[i]));
+        for (size_t j = 0; j < ket_indices.size(); ++j) {
+            DOCTEST_CHECK(restricted(i, j) == parent(ket_indices[i], ket_indices[j]));
+        }
+    }
+
+    DOCTEST_CHECK_THROWS_AS(basis->restricted({basis->get_number_of_kets()}),
+                            std::invalid_argument);
+    DOCTEST_CHECK_THROWS_AS(basis->restricted({0, 1, 0}), std::invalid_argument);
+}
+
 DOCTEST_TEST_CASE("calculation of matrix elements") {
     auto &database = Database::get_global_instance();
 
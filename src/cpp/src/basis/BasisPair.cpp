@@ -5,30 +5,42 @@
 #include "pairinteraction/database/Database.hpp"
 #include "pairinteraction/ket/KetAtom.hpp"
 #include "pairinteraction/ket/KetPair.hpp"
+#include "pairinteraction/operator/OperatorAtom.hpp"
 #include "pairinteraction/system/SystemAtom.hpp"
 #include "pairinteraction/utils/Range.hpp"
 #include "pairinteraction/utils/tensor.hpp"
 
+#include <array>
+#include <exception>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <oneapi/tbb.h>
 #include <vector>
 
 namespace pairinteraction {
 template <typename Scalar>
 BasisPair<Scalar>::BasisPair(Private /*unused*/, ketvec_t &&kets,
+                             std::shared_ptr<const KetStorage> ket_storage,
                              map_range_t &&map_range_of_state_index2,
                              map_indices_t &&state_indices_to_ket_index,
                              std::shared_ptr<const BasisAtom<Scalar>> basis1,
-                             std::shared_ptr<const BasisAtom<Scalar>> basis2)
-    : Basis<BasisPair<Scalar>>(std::move(kets)),
-      map_range_of_state_index2(std::move(map_range_of_state_index2)),
-      state_indices_to_ket_index(std::move(state_indices_to_ket_index)), basis1(std::move(basis1)),
-      basis2(std::move(basis2)) {}
+                             std::shared_ptr<const BasisAtom<Scalar>> basis2,
+                             std::vector<TransformationType> transformation_type)
+    : Basis<BasisPair<Scalar>>(std::move(kets), std::move(transformation_type)),
+      ket_storage(std::move(ket_storage)),
+      map_range_of_state_index2(
+          std::make_shared<const map_range_t>(std::move(map_range_of_state_index2))),
+      state_indices_to_ket_index(
+          std::make_shared<const map_indices_t>(std::move(state_indices_to_ket_index))),
+      basis1(std::move(basis1)), basis2(std::move(basis2)),
+      matrix_elements_cache(std::make_shared<MatrixElementsCache>()) {}
 
 template <typename Scalar>
 const typename BasisPair<Scalar>::range_t &
 BasisPair<Scalar>::get_index_range(size_t state_index1) const {
-    return map_range_of_state_index2.at(state_index1);
+    return map_range_of_state_index2->at(state_index1);
 }
 
 template <typename Scalar>
@@ -43,19 +55,50 @@ std::shared_ptr<const BasisAtom<Scalar>> BasisPair<Scalar>::get_basis2() const {
 
 template <typename Scalar>
 int BasisPair<Scalar>::get_ket_index_from_tuple(size_t state_index1, size_t state_index2) const {
-    if (state_indices_to_ket_index.count({state_index1, state_index2}) == 0) {
+    auto it = state_indices_to_ket_index->find({state_index1, state_index2});
+    if (it == state_indices_to_ket_index->end()) {
         return -1;
     }
-    return state_indices_to_ket_index.at({state_index1, state_index2});
+    return static_cast<int>(it->second);
+}
+
+template <typename Scalar>
+Eigen::VectorX<Scalar>
+BasisPair<Scalar>::contract_with_coefficients(const Eigen::SparseVector<Scalar> &vector1,
+                                              const Eigen::SparseVector<Scalar> &vector2) const {
+    constexpr real_t numerical_precision = 100 * std::numeric_limits<real_t>::epsilon();
+    const auto &coefficients = this->get_coefficients();
+
+    Eigen::VectorX<Scalar> result = Eigen::VectorX<Scalar>::Zero(coefficients.cols());
+    for (typename Eigen::SparseVector<Scalar>::InnerIterator it1(vector1); it1; ++it1) {
+        for (typename Eigen::SparseVector<Scalar>::InnerIterator it2(vector2); it2; ++it2) {
+            Scalar value = it1.value() * it2.value();
+            if (std::abs(value) <= numerical_precision) {
+                continue;
+            }
+            int ket_index = get_ket_index_from_tuple(it1.index(), it2.index());
+            if (ket_index < 0) {
+                continue;
+            }
+            for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it(
+                     coefficients, ket_index);
+                 it; ++it) {
+                result[it.col()] += value * it.value();
+            }
+        }
+    }
+    return result;
 }
 
 template <typename Scalar>
 Eigen::VectorX<Scalar>
 BasisPair<Scalar>::get_amplitudes(std::shared_ptr<const KetAtom> ket1,
                                   std::shared_ptr<const KetAtom> ket2) const {
-    return get_amplitudes(basis1->get_canonical_state_from_ket(ket1),
-                          basis2->get_canonical_state_from_ket(ket2))
-        .transpose();
+    // The following line is a more efficient alternative to
+    // "get_amplitudes(basis1->get_canonical_state_from_ket(ket1),
+    // basis2->get_canonical_state_from_ket(ket2)).transpose()"
+    return contract_with_coefficients(basis1->get_amplitudes(ket1).sparseView(),
+                                      basis2->get_amplitudes(ket2).sparseView());
 }
 
 template <typename Scalar>
@@ -67,69 +110,64 @@ BasisPair<Scalar>::get_amplitudes(std::shared_ptr<const BasisAtom<Scalar>> other
         throw std::invalid_argument("The other objects must be expressed using the same kets.");
     }
 
-    constexpr real_t numerical_precision = 100 * std::numeric_limits<real_t>::epsilon();
+    // The amplitudes are (coefficients1 ⊗ coefficients2)^† applied to the coefficients of this
+    // basis, where the rows of the result span the full product space of the other bases
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> coefficients1_adjoint =
+        (basis1->get_coefficients().adjoint() * other1->get_coefficients()).adjoint();
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> coefficients2_adjoint =
+        (basis2->get_coefficients().adjoint() * other2->get_coefficients()).adjoint();
+    coefficients1_adjoint.makeCompressed();
+    coefficients2_adjoint.makeCompressed();
+
+    return utils::TensorProductOperator<Scalar>(this->shared_from_this(), coefficients1_adjoint,
+                                                coefficients2_adjoint)
+        .apply(this->get_coefficients());
+}
 
-    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> coefficients1 =
-        basis1->get_coefficients().adjoint() * other1->get_coefficients();
-    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> coefficients2 =
-        basis2->get_coefficients().adjoint() * other2->get_coefficients();
+template <typename Scalar>
+Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
+BasisPair<Scalar>::get_amplitudes(const std::vector<std::shared_ptr<const KetAtom>> &kets1,
+                                  const std::vector<std::shared_ptr<const KetAtom>> &kets2) const {
+    if (kets1.size() != kets2.size()) {
+        throw std::invalid_argument("The number of kets of both atoms must be equal.");
+    }
 
-    oneapi::tbb::concurrent_vector<Eigen::Triplet<Scalar>> triplets;
+    // Extract the amplitudes of all atomic kets at once, and contract them pair by pair
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> amplitudes1 = basis1->get_amplitudes(kets1);
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> amplitudes2 = basis2->get_amplitudes(kets2);
+    std::vector<Eigen::SparseVector<Scalar>> rows(kets1.size());
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<size_t>(0, kets1.size()), [&](const auto &range) {
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                auto row = static_cast<Eigen::Index>(i);
+                rows[i] = contract_with_coefficients(amplitudes1.row(row).transpose(),
+                                                     amplitudes2.row(row).transpose())
+                              .sparseView();
+            }
+        });
 
-    // Loop over the rows of the first coefficient matrix
+    std::vector<int> outerIndexPtr(kets1.size() + 1, 0);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        outerIndexPtr[i + 1] = outerIndexPtr[i] + static_cast<int>(rows[i].nonZeros());
+    }
+    std::vector<int> innerIndices(outerIndexPtr.back());
+    std::vector<Scalar> values(outerIndexPtr.back());
     oneapi::tbb::parallel_for(
-        oneapi::tbb::blocked_range<Eigen::Index>(0, coefficients1.outerSize()),
-        [&](const auto &range) {
-            for (Eigen::Index row1 = range.begin(); row1 != range.end(); ++row1) {
-
-                const auto &range_row2 = this->get_index_range(row1);
-
-                // Loop over the rows of the second coefficient matrix that are energetically
-                // allowed
-                for (auto row2 = static_cast<Eigen::Index>(range_row2.min());
-                     row2 < static_cast<Eigen::Index>(range_row2.max()); ++row2) {
-
-                    Eigen::Index row = get_ket_index_from_tuple(row1, row2);
-                    if (row < 0) {
-                        continue;
-                    }
-
-                    // Loop over the non-zero column elements of the first coefficient matrix
-                    for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it1(
-                             coefficients1, row1);
-                         it1; ++it1) {
-
-                        Eigen::Index col1 = it1.col();
-                        Scalar value1 = it1.value();
-
-                        // Loop over the non-zero column elements of the second coefficient matrix
-                        for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator
-                                 it2(coefficients2, row2);
-                             it2; ++it2) {
-
-                            Eigen::Index col2 = it2.col();
-                            Scalar value2 = it2.value();
-                            Eigen::Index col = col1 * coefficients2.cols() + col2;
-
-                            // Store the entry
-                            Scalar value = value1 * value2;
-                            if (std::abs(value) > numerical_precision) {
-                                triplets.emplace_back(row, col, value);
-                            }
-                        }
-                    }
+        oneapi::tbb::blocked_range<size_t>(0, rows.size()), [&](const auto &range) {
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                int idx = outerIndexPtr[i];
+                for (typename Eigen::SparseVector<Scalar>::InnerIterator it(rows[i]); it;
+                     ++it, ++idx) {
+                    innerIndices[idx] = static_cast<int>(it.index());
+                    values[idx] = it.value();
                 }
             }
         });
 
-    // Construct the combined matrix from the triplets
-    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> matrix(this->get_number_of_kets(),
-                                                        other1->get_number_of_states() *
-                                                            other2->get_number_of_states());
-    matrix.setFromTriplets(triplets.begin(), triplets.end());
-    matrix.makeCompressed();
-
-    return matrix.adjoint() * this->get_coefficients();
+    return Eigen::Map<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>(
+        static_cast<Eigen::Index>(rows.size()),
+        static_cast<Eigen::Index>(this->get_number_of_states()), values.size(),
+        outerIndexPtr.data(), innerIndices.data(), values.data());
 }
 
 template <typename Scalar>
@@ -139,6 +177,13 @@ BasisPair<Scalar>::get_overlaps(std::shared_ptr<const KetAtom> ket1,
     return get_amplitudes(ket1, ket2).cwiseAbs2();
 }
 
+template <typename Scalar>
+Eigen::SparseMatrix<typename BasisPair<Scalar>::real_t, Eigen::RowMajor>
+BasisPair<Scalar>::get_overlaps(const std::vector<std::shared_ptr<const KetAtom>> &kets1,
+                                const std::vector<std::shared_ptr<const KetAtom>> &kets2) const {
+    return get_amplitudes(kets1, kets2).cwiseAbs2();
+}
+
 template <typename Scalar>
 Eigen::SparseMatrix<typename BasisPair<Scalar>::real_t, Eigen::RowMajor>
 BasisPair<Scalar>::get_overlaps(std::shared_ptr<const BasisAtom<Scalar>> other1,
@@ -173,12 +218,18 @@ BasisPair<Scalar>::get_matrix_elements(std::shared_ptr<const Type> final, Operat
         initial1->get_database().get_matrix_elements(initial1, final1, type1, q1);
     auto matrix_elements2 =
         initial2->get_database().get_matrix_elements(initial2, final2, type2, q2);
-    auto matrix_elements = utils::calculate_tensor_product(this->shared_from_this(), final,
-                                                           matrix_elements1, matrix_elements2);
-    assert(static_cast<size_t>(matrix_elements.rows()) == final->get_number_of_kets());
-    assert(static_cast<size_t>(matrix_elements.cols()) == this->get_number_of_kets());
-
-    return final->get_coefficients().adjoint() * matrix_elements * this->get_coefficients();
+    matrix_elements1.makeCompressed();
+    matrix_elements2.makeCompressed();
+
+    // Apply the tensor product of the matrix elements to the states of this basis without
+    // constructing the matrix elements between the pair kets
+    auto transformed_coefficients =
+        utils::TensorProductOperator<Scalar>(this->shared_from_this(), matrix_elements1,
+                                             matrix_elements2)
+            .apply(final, this->get_coefficients());
+    assert(static_cast<size_t>(transformed_coefficients.rows()) == final->get_number_of_kets());
+
+    return final->get_coefficients().adjoint() * transformed_coefficients;
 }
 
 template <typename Scalar>
@@ -203,11 +254,17 @@ template <typename Scalar>
 Eigen::VectorX<Scalar>
 BasisPair<Scalar>::get_matrix_elements(std::shared_ptr<const ket_t> ket, OperatorType type1,
                                        OperatorType type2, int q1, int q2) const {
-    // Construct a pair basis containing only the pair ket
-    auto final = this->get_canonical_state_from_ket(ket);
-    assert(final->get_number_of_states() == 1);
-
-    return this->get_matrix_elements(final, type1, type2, q1, q2).row(0);
+    // The following lines are a more efficient alternative to
+    // "get_matrix_elements(get_canonical_state_from_ket(ket), type1, type2, q1, q2).row(0)"
+    if (this->get_ket_index_from_ket(ket) < 0) {
+        throw std::invalid_argument("The ket does not belong to the basis.");
+    }
+    const auto &atomic_indices = ket->get_atomic_indices();
+    Eigen::SparseVector<Scalar> matrix_elements1 =
+        get_matrix_elements_of_atom(0, type1, q1)->row(atomic_indices[0]).transpose();
+    Eigen::SparseVector<Scalar> matrix_elements2 =
+        get_matrix_elements_of_atom(1, type2, q2)->row(atomic_indices[1]).transpose();
+    return contract_with_coefficients(matrix_elements1, matrix_elements2);
 }
 
 template <typename Scalar>
@@ -215,16 +272,69 @@ Eigen::VectorX<Scalar>
 BasisPair<Scalar>::get_matrix_elements(std::shared_ptr<const KetAtom> ket1,
                                        std::shared_ptr<const KetAtom> ket2, OperatorType type1,
                                        OperatorType type2, int q1, int q2) const {
-    // Construct a pair basis with the two single-atom kets
-    auto final1 = this->get_basis1()->get_canonical_state_from_ket(ket1);
-    auto final2 = this->get_basis2()->get_canonical_state_from_ket(ket2);
-    auto system1 = SystemAtom<Scalar>(final1);
-    auto system2 = SystemAtom<Scalar>(final2);
-    auto final = BasisPairCreator<Scalar>().add(system1).add(system2).create();
-    assert(final->get_number_of_states() == 1);
-    assert(final->get_number_of_kets() == 1);
+    // Instead of constructing a pair basis with the two single-atom kets, the matrix elements of
+    // the single atoms are directly contracted with the coefficients of the pair basis
+    return contract_with_coefficients(basis1->get_matrix_elements(ket1, type1, q1).sparseView(),
+                                      basis2->get_matrix_elements(ket2, type2, q2).sparseView());
+}
+
+template <typename Scalar>
+template <typename Key, typename Compute>
+std::shared_ptr<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>
+BasisPair<Scalar>::get_cached_matrix(std::map<Key, cached_matrix_t> &matrices, const Key &key,
+                                     Compute &&compute) const {
+    std::promise<std::shared_ptr<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>> promise;
+    cached_matrix_t future;
+    bool is_calculated_here = false;
+    {
+        std::lock_guard<std::mutex> lock(matrix_elements_cache->mutex);
+        auto [it, inserted] = matrices.try_emplace(key);
+        if (inserted) {
+            it->second = promise.get_future().share();
+            is_calculated_here = true;
+        }
+        future = it->second;
+    }
+
+    if (is_calculated_here) {
+        try {
+            // The calculation is isolated so that the thread does not pick up another task while
+            // waiting for parallel work, which could wait for this very future
+            auto matrix = oneapi::tbb::this_task_arena::isolate([&]() { return compute(); });
+            promise.set_value(std::make_shared<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>(
+                std::move(matrix)));
+        } catch (...) {
+            // Remove the entry so that the calculation can be retried
+            {
+                std::lock_guard<std::mutex> lock(matrix_elements_cache->mutex);
+                matrices.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+        }
+    }
+    return future.get();
+}
 
-    return this->get_matrix_elements(final, type1, type2, q1, q2).row(0);
+template <typename Scalar>
+std::shared_ptr<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>
+BasisPair<Scalar>::get_matrix_elements_of_kets(OperatorType type1, OperatorType type2, int q1,
+                                               int q2) const {
+    std::array<int, 4> key{static_cast<int>(type1), q1, static_cast<int>(type2), q2};
+    return get_cached_matrix(matrix_elements_cache->matrices, key, [&]() {
+        auto matrix1 = OperatorAtom<Scalar>(basis1, type1, q1).get_matrix();
+        auto matrix2 = OperatorAtom<Scalar>(basis2, type2, q2).get_matrix();
+        return utils::calculate_tensor_product(this->shared_from_this(), this->shared_from_this(),
+                                               matrix1, matrix2);
+    });
+}
+
+template <typename Scalar>
+std::shared_ptr<const Eigen::SparseMatrix<Scalar, Eigen::RowMajor>>
+BasisPair<Scalar>::get_matrix_elements_of_atom(size_t atom, OperatorType type, int q) const {
+    std::array<int, 3> key{static_cast<int>(atom), static_cast<int>(type), q};
+    return get_cached_matrix(matrix_elements_cache->atomic_matrices, key, [&]() {
+        return OperatorAtom<Scalar>(atom == 0 ? basis1 : basis2, type, q).get_matrix();
+    });
 }
 
 // Explicit instantiations
@@ -7,14 +7,23 @@
 #include "pairinteraction/ket/KetAtom.hpp"
 #include "pairinteraction/ket/KetPair.hpp"
 #include "pairinteraction/system/SystemAtom.hpp"
+#include "pairinteraction/utils/sorting.hpp"
 
+#include <Eigen/SparseCore>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <limits>
 #include <memory>
+#include <numeric>
+#include <oneapi/tbb.h>
+#include <optional>
+#include <vector>
 
 namespace pairinteraction {
 template <typename Scalar>
-BasisPairCreator<Scalar>::BasisPairCreator() : product_of_parities(Parity::UNKNOWN) {}
+BasisPairCreator<Scalar>::BasisPairCreator()
+    : product_of_parities(Parity::UNKNOWN), exchange_symmetrization(false) {}
 
 template <typename Scalar>
 BasisPairCreator<Scalar> &BasisPairCreator<Scalar>::add(const SystemAtom<Scalar> &system_atom) {
@@ -44,6 +53,13 @@ BasisPairCreator<Scalar> &BasisPairCreator<Scalar>::restrict_product_of_parities
     return *this;
 }
 
+template <typename Scalar>
+BasisPairCreator<Scalar> &
+BasisPairCreator<Scalar>::enable_exchange_symmetrization(bool enable) {
+    exchange_symmetrization = enable;
+    return *this;
+}
+
 template <typename Scalar>
 std::shared_ptr<const BasisPair<Scalar>> BasisPairCreator<Scalar>::create() const {
     if (systems_atom.size() != 2) {
@@ -67,79 +83,236 @@ std::shared_ptr<const BasisPair<Scalar>> BasisPairCreator<Scalar>::create() cons
     real_t *eigenvalues2_begin = eigenvalues2.data();
     real_t *eigenvalues2_end = eigenvalues2_begin + eigenvalues2.size();
 
-    ketvec_t kets;
-    kets.reserve(eigenvalues1.size() * eigenvalues2.size());
+    if (range_quantum_number_m.is_finite() &&
+        (!basis1->has_quantum_number_m() || !basis2->has_quantum_number_m())) {
+        throw std::invalid_argument(
+            "The quantum number m must not be restricted because it is not well-defined.");
+    }
 
-    typename basis_t::map_range_t map_range_of_state_index2;
-    map_range_of_state_index2.reserve(eigenvalues1.size());
+    // The exchange of the atoms only is a symmetry if both atoms are described by the same states
+    if (exchange_symmetrization &&
+        (basis1->get_id_of_kets() != basis2->get_id_of_kets() ||
+         eigenvalues1.size() != eigenvalues2.size() ||
+         (eigenvalues1 - eigenvalues2).norm() > numerical_precision * eigenvalues1.norm() ||
+         (basis1->get_coefficients() - basis2->get_coefficients()).norm() >
+             numerical_precision * basis1->get_coefficients().norm())) {
+        throw std::invalid_argument(
+            "The pair states can only be symmetrized if both SystemAtom describe identical atoms.");
+    }
 
-    typename basis_t::map_indices_t state_indices_to_ket_index;
+    auto number_of_states1 = static_cast<size_t>(eigenvalues1.size());
+    std::vector<typename basis_t::range_t> ranges(number_of_states1);
+    std::vector<size_t> offsets(number_of_states1 + 1, 0);
 
-    // Loop only over states with an allowed energy
-    size_t ket_index = 0;
-    for (size_t idx1 = 0; idx1 < static_cast<size_t>(eigenvalues1.size()); ++idx1) {
-        // Get the energetically allowed range of the second index
-        size_t min = 0;
-        size_t max = eigenvalues2.size();
-        if (range_energy.is_finite()) {
-            real_t min_val2 = range_energy.min() - eigenvalues1[idx1];
-            real_t max_val2 = range_energy.max() - eigenvalues1[idx1];
-            min = std::distance(eigenvalues2_begin,
-                                std::lower_bound(eigenvalues2_begin, eigenvalues2_end, min_val2));
-            max = std::distance(eigenvalues2_begin,
-                                std::upper_bound(eigenvalues2_begin, eigenvalues2_end, max_val2));
+    // Checks whether the pair of states has an allowed parity and quantum number m, the energy is
+    // checked by restricting the range of the second index
+    auto is_allowed = [&](size_t idx1, size_t idx2) {
+        if (product_of_parities != Parity::UNKNOWN &&
+            static_cast<int>(basis1->get_parity(idx1)) *
+                    static_cast<int>(basis2->get_parity(idx2)) !=
+                static_cast<int>(product_of_parities)) {
+            return false;
         }
-        map_range_of_state_index2.emplace(idx1, typename basis_t::range_t(min, max));
-
-        // Loop over the energetically allowed range of the second index
-        for (size_t idx2 = min; idx2 < max; ++idx2) {
-            // Get energy
-            const real_t energy = eigenvalues1[idx1] + eigenvalues2[idx2];
-            assert(!range_energy.is_finite() ||
-                   (energy >= range_energy.min() && energy <= range_energy.max()));
-
-            // Check the parity of the sum of the parities
-            if (product_of_parities != Parity::UNKNOWN) {
-                if (static_cast<int>(basis1->get_parity(idx1)) *
-                        static_cast<int>(basis2->get_parity(idx2)) !=
-                    static_cast<int>(product_of_parities)) {
-                    continue;
+        if (range_quantum_number_m.is_finite()) {
+            real_t quantum_number_m =
+                basis1->get_quantum_number_m(idx1) + basis2->get_quantum_number_m(idx2);
+            if (quantum_number_m < range_quantum_number_m.min() - numerical_precision ||
+                quantum_number_m > range_quantum_number_m.max() + numerical_precision) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Determine the energetically allowed range of the second index and count the allowed pairs
+    // of states for each state of the first atom in parallel
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<size_t>(0, number_of_states1), [&](const auto &range) {
+            for (size_t idx1 = range.begin(); idx1 != range.end(); ++idx1) {
+                size_t min = 0;
+                size_t max = eigenvalues2.size();
+                if (range_energy.is_finite()) {
+                    real_t min_val2 = range_energy.min() - eigenvalues1[idx1];
+                    real_t max_val2 = range_energy.max() - eigenvalues1[idx1];
+                    min = std::distance(
+                        eigenvalues2_begin,
+                        std::lower_bound(eigenvalues2_begin, eigenvalues2_end, min_val2));
+                    max = std::distance(
+                        eigenvalues2_begin,
+                        std::upper_bound(eigenvalues2_begin, eigenvalues2_end, max_val2));
+                }
+                ranges[idx1] = typename basis_t::range_t(min, max);
+
+                size_t count = 0;
+                for (size_t idx2 = min; idx2 < max; ++idx2) {
+                    count += is_allowed(idx1, idx2) ? 1 : 0;
                 }
+                offsets[idx1 + 1] = count;
             }
+        });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    size_t number_of_kets = offsets.back();
 
-            // Create a KetPair object
-            auto ket = std::make_shared<ket_t>(
-                typename ket_t::Private(), std::initializer_list<size_t>{idx1, idx2},
-                std::initializer_list<std::shared_ptr<const BasisAtom<Scalar>>>{basis1, basis2},
-                energy);
-
-            // Check the quantum number m
-            if (ket->has_quantum_number_m()) {
-                if (range_quantum_number_m.is_finite() &&
-                    (ket->get_quantum_number_m() <
-                         range_quantum_number_m.min() - numerical_precision ||
-                     ket->get_quantum_number_m() >
-                         range_quantum_number_m.max() + numerical_precision)) {
-                    continue;
+    // Construct the KetPair objects in parallel within one contiguous storage that is owned by the
+    // pair basis. The kets are non-owning pointers into the storage and refer to the atomic bases
+    // that are kept in the storage as well, so that constructing a ket neither requires a separate
+    // allocation nor touches a shared reference count.
+    auto ket_storage = std::make_shared<typename basis_t::KetStorage>();
+    ket_storage->atomic_bases = {basis1, basis2};
+    ket_storage->kets.resize(number_of_kets);
+    // Aliasing an empty shared pointer creates a shared pointer without a control block
+    const std::shared_ptr<const void> no_owner;
+    ketvec_t kets(number_of_kets);
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<size_t>(0, number_of_states1), [&](const auto &range) {
+            for (size_t idx1 = range.begin(); idx1 != range.end(); ++idx1) {
+                size_t ket_index = offsets[idx1];
+                for (size_t idx2 = ranges[idx1].min(); idx2 < ranges[idx1].max(); ++idx2) {
+                    if (!is_allowed(idx1, idx2)) {
+                        continue;
+                    }
+                    const real_t energy = eigenvalues1[idx1] + eigenvalues2[idx2];
+                    assert(!range_energy.is_finite() ||
+                           (energy >= range_energy.min() && energy <= range_energy.max()));
+
+                    auto &ket = ket_storage->kets[ket_index].emplace(
+                        typename ket_t::Private(), typename ket_t::atomic_indices_t{idx1, idx2},
+                        &ket_storage->atomic_bases, energy);
+                    kets[ket_index] = std::shared_ptr<const ket_t>(no_owner, &ket);
+                    ++ket_index;
                 }
-            } else if (range_quantum_number_m.is_finite()) {
-                throw std::invalid_argument(
-                    "The quantum number m must not be restricted because it is not well-defined.");
+                assert(ket_index == offsets[idx1 + 1]);
             }
+        });
+
+    // Group the kets by the total quantum number m, keeping their order within a group. As the
+    // pair Hamiltonian usually conserves m, it can then be split into blocks without sorting it.
+    bool is_sorted_by_quantum_number_m =
+        basis1->has_quantum_number_m() && basis2->has_quantum_number_m();
+    if (is_sorted_by_quantum_number_m) {
+        auto get_twice_quantum_number_m = [](const auto &basis, size_t state_index) {
+            return std::llround(2 * basis->get_quantum_number_m(state_index));
+        };
+        auto get_min_twice_quantum_number_m = [&](const auto &basis) {
+            long long min = std::numeric_limits<long long>::max();
+            for (size_t state_index = 0; state_index < basis->get_number_of_states();
+                 ++state_index) {
+                min = std::min(min, get_twice_quantum_number_m(basis, state_index));
+            }
+            return min;
+        };
+        long long min_twice_quantum_number_m =
+            get_min_twice_quantum_number_m(basis1) + get_min_twice_quantum_number_m(basis2);
+
+        std::vector<std::uint64_t> keys(number_of_kets);
+        oneapi::tbb::parallel_for(size_t{0}, number_of_kets, [&](size_t ket_index) {
+            const auto &[idx1, idx2] = kets[ket_index]->get_atomic_indices();
+            keys[ket_index] = static_cast<std::uint64_t>(get_twice_quantum_number_m(basis1, idx1) +
+                                                         get_twice_quantum_number_m(basis2, idx2) -
+                                                         min_twice_quantum_number_m);
+        });
+        std::uint64_t max_key = *std::max_element(keys.begin(), keys.end());
+        int number_of_bits = 0;
+        while (number_of_bits < 64 && (max_key >> number_of_bits) != 0) {
+            ++number_of_bits;
+        }
+
+        std::vector<size_t> order(number_of_kets);
+        std::iota(order.begin(), order.end(), 0);
+        sorting::stable_sort_by_key(keys, order.data(), number_of_bits);
 
-            // Store the KetPair object as a ket
-            kets.emplace_back(std::move(ket));
+        ketvec_t sorted_kets(number_of_kets);
+        oneapi::tbb::parallel_for(size_t{0}, number_of_kets, [&](size_t ket_index) {
+            sorted_kets[ket_index] = std::move(kets[order[ket_index]]);
+        });
+        kets = std::move(sorted_kets);
+    }
+
+    // Store the ranges and ket indices
+    typename basis_t::map_range_t map_range_of_state_index2;
+    map_range_of_state_index2.reserve(number_of_states1);
+    for (size_t idx1 = 0; idx1 < number_of_states1; ++idx1) {
+        map_range_of_state_index2.emplace(idx1, ranges[idx1]);
+    }
 
-            // Store the ket index
-            state_indices_to_ket_index.emplace(std::vector<size_t>{idx1, idx2}, ket_index++);
+    typename basis_t::map_indices_t state_indices_to_ket_index;
+    state_indices_to_ket_index.reserve(number_of_kets);
+    for (size_t ket_index = 0; ket_index < number_of_kets; ++ket_index) {
+        state_indices_to_ket_index.emplace(kets[ket_index]->get_atomic_indices(), ket_index);
+    }
+
+    // Record that the states are sorted by the total quantum number m, so that the states do not
+    // have to be sorted before splitting the Hamiltonian into blocks
+    std::vector<TransformationType> order_of_kets;
+    if (is_sorted_by_quantum_number_m) {
+        order_of_kets.push_back(TransformationType::SORT_BY_QUANTUM_NUMBER_M);
+    }
+    order_of_kets.push_back(TransformationType::SORT_BY_KET);
+
+    std::shared_ptr<const basis_t> basis = std::make_shared<basis_t>(
+        typename basis_t::Private(), std::move(kets), std::move(ket_storage),
+        std::move(map_range_of_state_index2),
+        std::move(state_indices_to_ket_index), basis1, basis2, std::move(order_of_kets));
+
+    if (!exchange_symmetrization) {
+        return basis;
+    }
+
+    // Combine the kets |i,j> and |j,i> to the symmetric state (|i,j> + |j,i>)/sqrt(2) and the
+    // antisymmetric state (|i,j> - |j,i>)/sqrt(2), the ket |i,i> is symmetric by itself. Within
+    // each group of kets with the same total quantum number m, the antisymmetric states are
+    // placed before the symmetric ones so that the states are sorted by m and the parity.
+    const real_t inv_sqrt2 = 1 / std::sqrt(real_t(2));
+    std::vector<Eigen::Triplet<Scalar>> triplets;
+    triplets.reserve(2 * number_of_kets);
+    std::vector<Parity> parities;
+    parities.reserve(number_of_kets);
+    size_t group_begin = 0;
+    while (group_begin < number_of_kets) {
+        size_t group_end = is_sorted_by_quantum_number_m ? group_begin + 1 : number_of_kets;
+        while (group_end < number_of_kets &&
+               std::abs(basis->get_quantum_number_m(group_end) -
+                        basis->get_quantum_number_m(group_begin)) <= numerical_precision) {
+            ++group_end;
+        }
+
+        for (Parity parity : {Parity::ODD, Parity::EVEN}) {
+            real_t sign = parity == Parity::EVEN ? 1 : -1;
+            for (size_t ket_index = group_begin; ket_index < group_end; ++ket_index) {
+                const auto &[idx1, idx2] = basis->get_ket(ket_index)->get_atomic_indices();
+                if (idx1 > idx2 || (idx1 == idx2 && parity == Parity::ODD)) {
+                    continue;
+                }
+                auto state_index = static_cast<int>(parities.size());
+                parities.push_back(parity);
+                if (idx1 == idx2) {
+                    triplets.emplace_back(static_cast<int>(ket_index), state_index, 1);
+                    continue;
+                }
+                int partner_index = basis->get_ket_index_from_tuple(idx2, idx1);
+                if (partner_index < 0) {
+                    throw std::runtime_error("The exchanged pair state is missing in the basis.");
+                }
+                triplets.emplace_back(static_cast<int>(ket_index), state_index, inv_sqrt2);
+                triplets.emplace_back(partner_index, state_index, sign * inv_sqrt2);
+            }
         }
+        group_begin = group_end;
     }
+    assert(parities.size() == number_of_kets);
 
-    kets.shrink_to_fit();
+    std::vector<TransformationType> transformation_type;
+    if (is_sorted_by_quantum_number_m) {
+        transformation_type.push_back(TransformationType::SORT_BY_QUANTUM_NUMBER_M);
+    }
+    transformation_type.push_back(TransformationType::SORT_BY_PARITY);
+    transformation_type.push_back(TransformationType::ARBITRARY);
 
-    return std::make_shared<basis_t>(typename basis_t::Private(), std::move(kets),
-                                     std::move(map_range_of_state_index2),
-                                     std::move(state_indices_to_ket_index), basis1, basis2);
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> matrix(static_cast<int>(number_of_kets),
+                                                        static_cast<int>(number_of_kets));
+    matrix.setFromTriplets(triplets.begin(), triplets.end());
+    return basis->transformed(Transformation<Scalar>{std::move(matrix), transformation_type})
+        ->with_parities(std::move(parities));
 }
 
 // Explicit instantiations
@@ -14,6 +14,7 @@
 #include "pairinteraction/system/SystemAtom.hpp"
 #include "pairinteraction/system/SystemPair.hpp"
 #include "pairinteraction/utils/streamed.hpp"
+#include "pairinteraction/utils/tensor.hpp"
 
 #include <doctest/doctest.h>
 
@@ -84,12 +85,65 @@ DOCTEST_TEST_CASE("create a BasisPair") {
         DOCTEST_CHECK(overlaps.sum() == doctest::Approx(0.9107819201));
     }
 
+    DOCTEST_SUBCASE("check overlaps of several pairs of kets at once") {
+        auto other_ket = KetAtomCreator()
+                             .set_species("Rb")
+                             .set_quantum_number_n(60)
+                             .set_quantum_number_l(1)
+                             .set_quantum_number_j(1.5)
+                             .set_quantum_number_m(0.5)
+                             .create(database);
+        std::vector<std::shared_ptr<const KetAtom>> kets1{ket, ket, other_ket};
+        std::vector<std::shared_ptr<const KetAtom>> kets2{ket, other_ket, ket};
+
+        auto overlaps = basis_pair_a->get_overlaps(kets1, kets2);
+        DOCTEST_CHECK(overlaps.rows() == 3);
+        DOCTEST_CHECK(overlaps.cols() == basis_pair_a->get_number_of_states());
+        for (size_t i = 0; i < kets1.size(); ++i) {
+            Eigen::VectorX<double> ref = basis_pair_a->get_overlaps(kets1[i], kets2[i]);
+            Eigen::VectorX<double> row = overlaps.row(i).transpose();
+            DOCTEST_CHECK(row.isApprox(ref, 1e-11));
+        }
+
+        DOCTEST_CHECK_THROWS_AS(basis_pair_a->get_overlaps(kets1, {ket}), std::invalid_argument);
+    }
+
     DOCTEST_SUBCASE("get the atomic states constituting a ket of the basis_pair") {
         auto atomic_states = basis_pair_a->get_kets()[0]->get_atomic_states();
         DOCTEST_CHECK(atomic_states.size() == 2);
         DOCTEST_CHECK(atomic_states[0]->get_number_of_states() == 1);
         DOCTEST_CHECK(atomic_states[0]->get_number_of_kets() == basis->get_number_of_kets());
     }
+
+    DOCTEST_SUBCASE("create the basis sorted by the quantum number m") {
+        auto basis_pair = pairinteraction::BasisPairCreator<double>()
+                              .add(system)
+                              .add(system)
+                              .restrict_energy(min_energy, max_energy)
+                              .create();
+        for (size_t i = 1; i < basis_pair->get_number_of_states(); ++i) {
+            DOCTEST_CHECK(basis_pair->get_quantum_number_m(i - 1) <=
+                          basis_pair->get_quantum_number_m(i));
+        }
+        auto blocks =
+            basis_pair->get_indices_of_blocks({TransformationType::SORT_BY_QUANTUM_NUMBER_M});
+        DOCTEST_CHECK(blocks.size() > 1);
+
+        auto basis_pair_symmetrized = pairinteraction::BasisPairCreator<double>()
+                                          .add(system)
+                                          .add(system)
+                                          .restrict_energy(min_energy, max_energy)
+                                          .enable_exchange_symmetrization(true)
+                                          .create();
+        blocks = basis_pair_symmetrized->get_indices_of_blocks(
+            {TransformationType::SORT_BY_QUANTUM_NUMBER_M, TransformationType::SORT_BY_PARITY});
+        for (const auto &block : blocks) {
+            for (size_t i = block.start + 1; i < block.end; ++i) {
+                DOCTEST_CHECK(basis_pair_symmetrized->get_parity(i) ==
+                              basis_pair_symmetrized->get_parity(block.start));
+            }
+        }
+    }
 }
 
 DOCTEST_TEST_CASE("get matrix elements in the pair basis") {
@@ -160,6 +214,26 @@ DOCTEST_TEST_CASE("get matrix elements in the pair basis") {
         auto matrix_elements_ket = basis_pair->get_matrix_elements(
             ket, ket, OperatorType::ELECTRIC_DIPOLE, OperatorType::ELECTRIC_DIPOLE, 0, 0);
         DOCTEST_CHECK(matrix_elements_ket.size() == basis_pair->get_number_of_states());
+
+        {
+            auto state = basis_pair->get_basis1()->get_canonical_state_from_ket(ket);
+            Eigen::VectorX<double> ref =
+                basis_pair
+                    ->get_matrix_elements(state, state, OperatorType::ELECTRIC_DIPOLE,
+                                          OperatorType::ELECTRIC_DIPOLE, 0, 0)
+                    .row(0);
+            DOCTEST_CHECK(ref.isApprox(matrix_elements_ket, 1e-11));
+        }
+
+        // <ket,ket|basis_pair>
+        auto amplitudes_ket = basis_pair->get_amplitudes(ket, ket);
+        DOCTEST_CHECK(amplitudes_ket.size() == basis_pair->get_number_of_states());
+
+        {
+            auto state = basis_pair->get_basis1()->get_canonical_state_from_ket(ket);
+            Eigen::VectorX<double> ref = basis_pair->get_amplitudes(state, state).row(0);
+            DOCTEST_CHECK(ref.isApprox(amplitudes_ket, 1e-11));
+        }
     }
 
     DOCTEST_SUBCASE("check matrix elements") {
@@ -194,6 +268,32 @@ DOCTEST_TEST_CASE("get matrix elements in the pair basis") {
         const auto &ref = system_pair.get_matrix();
         DOCTEST_CHECK(ref.isApprox(hamiltonian, 1e-11));
     }
+
+    DOCTEST_SUBCASE("apply a tensor product lazily") {
+        auto basis1 = basis_pair_unperturbed->get_basis1();
+        auto basis2 = basis_pair_unperturbed->get_basis2();
+        Eigen::SparseMatrix<double, Eigen::RowMajor> matrix1 =
+            basis1->get_database().get_matrix_elements(basis1, basis1,
+                                                       OperatorType::ELECTRIC_DIPOLE, 1);
+        Eigen::SparseMatrix<double, Eigen::RowMajor> matrix2 =
+            basis2->get_database().get_matrix_elements(basis2, basis2,
+                                                       OperatorType::ELECTRIC_DIPOLE, -1);
+        matrix1.makeCompressed();
+        matrix2.makeCompressed();
+
+        Eigen::SparseMatrix<double, Eigen::RowMajor> ref = utils::calculate_tensor_product(
+            basis_pair_unperturbed, basis_pair_unperturbed, matrix1, matrix2);
+        utils::TensorProductOperator<double> op(basis_pair_unperturbed, matrix1, matrix2);
+
+        Eigen::SparseMatrix<double, Eigen::RowMajor> coefficients = basis_pair->get_coefficients();
+        Eigen::MatrixXd ref_matrix = ref * coefficients;
+        Eigen::MatrixXd matrix = op.apply(basis_pair_unperturbed, coefficients);
+        DOCTEST_CHECK(ref_matrix.isApprox(matrix, 1e-11));
+
+        Eigen::VectorXd vector = Eigen::VectorXd::Random(coefficients.rows());
+        Eigen::VectorXd ref_vector = ref * vector;
+        DOCTEST_CHECK(ref_vector.isApprox(op.apply(basis_pair_unperturbed, vector), 1e-11));
+    }
 }
 
 } // namespace pairinteraction
@@ -4,7 +4,9 @@
 #include "pairinteraction/database/AtomDescriptionByParameters.hpp"
 #include "pairinteraction/database/AtomDescriptionByRanges.hpp"
 #include "pairinteraction/database/GitHubDownloader.hpp"
+#include "pairinteraction/database/MatrixElementsIndex.hpp"
 #include "pairinteraction/database/ParquetManager.hpp"
+#include "pairinteraction/database/StatesIndex.hpp"
 #include "pairinteraction/enums/OperatorType.hpp"
 #include "pairinteraction/enums/Parity.hpp"
 #include "pairinteraction/ket/KetAtom.hpp"
@@ -13,6 +15,7 @@
 #include "pairinteraction/utils/paths.hpp"
 #include "pairinteraction/utils/streamed.hpp"
 
+#include <algorithm>
 #include <cpptrace/cpptrace.hpp>
 #include <duckdb.hpp>
 #include <fmt/core.h>
@@ -22,6 +25,7 @@
 #include <oneapi/tbb.h>
 #include <spdlog/spdlog.h>
 #include <system_error>
+#include <unordered_map>
 
 namespace pairinteraction {
 Database::Database() : Database(default_download_missing) {}
@@ -33,8 +37,14 @@ Database::Database(std::filesystem::path database_dir)
     : Database(default_download_missing, default_use_cache, std::move(database_dir)) {}
 
 Database::Database(bool download_missing, bool use_cache, std::filesystem::path database_dir)
+    : Database(download_missing, use_cache, std::move(database_dir),
+               default_use_persistent_store) {}
+
+Database::Database(bool download_missing, bool use_cache, std::filesystem::path database_dir,
+                   bool use_persistent_store)
     : download_missing_(download_missing), use_cache_(use_cache),
-      database_dir_(std::move(database_dir)), db(std::make_unique<duckdb::DuckDB>(nullptr)),
+      use_persistent_store_(use_persistent_store), database_dir_(std::move(database_dir)),
+      db(std::make_unique<duckdb::DuckDB>(nullptr)),
       con(std::make_unique<duckdb::Connection>(*db)) {
 
     if (database_dir_.empty()) {
@@ -134,7 +144,7 @@ Database::Database(bool download_missing, bool use_cache, std::filesystem::path
     }
     downloader = std::make_unique<GitHubDownloader>();
     manager = std::make_unique<ParquetManager>(database_dir_, *downloader, database_repo_paths,
-                                               *con, use_cache_);
+                                               *con, use_cache_, use_persistent_store_);
     manager->scan_local();
     manager->scan_remote();
 
@@ -145,7 +155,7 @@ Database::Database(bool download_missing, bool use_cache, std::filesystem::path
     }
 }
 
-Database::~Database() = default;
+Database::~Database() { prefetch_task_group.wait(); }
 
 std::shared_ptr<const KetAtom> Database::get_ket(const std::string &species,
                                                  const AtomDescriptionByParameters &description) {
@@ -175,288 +185,126 @@ std::shared_ptr<const KetAtom> Database::get_ket(const std::string &species,
         throw std::invalid_argument("The quantum number m must be an integer or half-integer.");
     }
 
-    // Describe the state
-    std::string where;
-    std::string separator;
-    if (description.energy.has_value()) {
-        // The following condition derives from demanding that quantum number n that corresponds to
-        // the energy "E_n = -1/(2*n^2)" is not off by more than 1 from the actual quantum number n,
-        // i.e., "sqrt(-1/(2*E_n)) - sqrt(-1/(2*E_{n-1})) = 1"
-        where += separator +
-            fmt::format("SQRT(-1/(2*energy)) BETWEEN {} AND {}",
-                        std::sqrt(-1 / (2 * description.energy.value())) - 0.5,
-                        std::sqrt(-1 / (2 * description.energy.value())) + 0.5);
-        separator = " AND ";
-    }
-    if (description.quantum_number_f.has_value()) {
-        where += separator + fmt::format("f = {}", description.quantum_number_f.value());
-        separator = " AND ";
-    }
-    if (description.parity != Parity::UNKNOWN) {
-        where += separator + fmt::format("parity = {}", fmt::streamed(description.parity));
-        separator = " AND ";
-    }
-    if (description.quantum_number_n.has_value()) {
-        where += separator + fmt::format("n = {}", description.quantum_number_n.value());
-        separator = " AND ";
-    }
-    if (description.quantum_number_nu.has_value()) {
-        where += separator +
-            fmt::format("nu BETWEEN {} AND {}", description.quantum_number_nu.value() - 0.5,
-                        description.quantum_number_nu.value() + 0.5);
-        separator = " AND ";
-    }
-    if (description.quantum_number_nui.has_value()) {
-        where += separator +
-            fmt::format("exp_nui BETWEEN {} AND {}", description.quantum_number_nui.value() - 0.5,
-                        description.quantum_number_nui.value() + 0.5);
-        separator = " AND ";
-    }
-    if (description.quantum_number_l.has_value()) {
-        where += separator +
-            fmt::format("exp_l BETWEEN {} AND {}", description.quantum_number_l.value() - 0.5,
-                        description.quantum_number_l.value() + 0.5);
-        separator = " AND ";
-    }
-    if (description.quantum_number_s.has_value()) {
-        where += separator +
-            fmt::format("exp_s BETWEEN {} AND {}", description.quantum_number_s.value() - 0.5,
-                        description.quantum_number_s.value() + 0.5);
-        separator = " AND ";
-    }
-    if (description.quantum_number_j.has_value()) {
-        where += separator +
-            fmt::format("exp_j BETWEEN {} AND {}", description.quantum_number_j.value() - 0.5,
-                        description.quantum_number_j.value() + 0.5);
-        separator = " AND ";
-    }
-    if (description.quantum_number_l_ryd.has_value()) {
-        where += separator +
-            fmt::format("exp_l_ryd BETWEEN {} AND {}",
-                        description.quantum_number_l_ryd.value() - 0.5,
-                        description.quantum_number_l_ryd.value() + 0.5);
-        separator = " AND ";
-    }
-    if (description.quantum_number_j_ryd.has_value()) {
-        where += separator +
-            fmt::format("exp_j_ryd BETWEEN {} AND {}",
-                        description.quantum_number_j_ryd.value() - 0.5,
-                        description.quantum_number_j_ryd.value() + 0.5);
-        separator = " AND ";
-    }
-    if (separator.empty()) {
-        where += "FALSE";
-    }
-
-    std::string orderby;
-    separator = "";
-    if (description.energy.has_value()) {
-        orderby += separator +
-            fmt::format("(SQRT(-1/(2*energy)) - {})^2",
-                        std::sqrt(-1 / (2 * description.energy.value())));
-        separator = " + ";
-    }
-    if (description.quantum_number_nu.has_value()) {
-        orderby += separator + fmt::format("(nu - {})^2", description.quantum_number_nu.value());
-        separator = " + ";
-    }
-    if (description.quantum_number_nui.has_value()) {
-        orderby +=
-            separator + fmt::format("(exp_nui - {})^2", description.quantum_number_nui.value());
-        separator = " + ";
-    }
-    if (description.quantum_number_l.has_value()) {
-        orderby += separator + fmt::format("(exp_l - {})^2", description.quantum_number_l.value());
-        separator = " + ";
-    }
-    if (description.quantum_number_s.has_value()) {
-        orderby += separator + fmt::format("(exp_s - {})^2", description.quantum_number_s.value());
-        separator = " + ";
-    }
-    if (description.quantum_number_j.has_value()) {
-        orderby += separator + fmt::format("(exp_j - {})^2", description.quantum_number_j.value());
-        separator = " + ";
-    }
-    if (description.quantum_number_l_ryd.has_value()) {
-        orderby +=
-            separator + fmt::format("(exp_l_ryd - {})^2", description.quantum_number_l_ryd.value());
-        separator = " + ";
-    }
-    if (description.quantum_number_j_ryd.has_value()) {
-        orderby +=
-            separator + fmt::format("(exp_j_ryd - {})^2", description.quantum_number_j_ryd.value());
-        separator = " + ";
-    }
-    if (separator.empty()) {
-        orderby += "id";
+    // Return the ket if the same description has been resolved before
+    auto format_optional = [](const auto &value) {
+        return value.has_value() ? fmt::format("{}", value.value()) : std::string("-");
+    };
+    std::string ket_key = fmt::format(
+        "{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}", species, static_cast<int>(description.parity),
+        format_optional(description.energy), format_optional(description.quantum_number_f),
+        format_optional(description.quantum_number_m),
+        format_optional(description.quantum_number_n),
+        format_optional(description.quantum_number_nu),
+        format_optional(description.quantum_number_nui),
+        format_optional(description.quantum_number_l),
+        format_optional(description.quantum_number_s),
+        format_optional(description.quantum_number_j),
+        format_optional(description.quantum_number_l_ryd),
+        format_optional(description.quantum_number_j_ryd));
+    {
+        std::lock_guard<std::mutex> lock(mtx_kets);
+        if (auto it = kets.find(ket_key); it != kets.end()) {
+            return it->second;
+        }
     }
 
-    // Ask the database for the described state
-    auto result = con->Query(fmt::format(
-        R"(SELECT energy, f, parity, id, n, nu, exp_nui, std_nui, exp_l, std_l, exp_s, std_s,
-        exp_j, std_j, exp_l_ryd, std_l_ryd, exp_j_ryd, std_j_ryd, is_j_total_momentum, is_calculated_with_mqdt, {} AS order_val FROM '{}' WHERE {} ORDER BY order_val ASC LIMIT 2)",
-        orderby, manager->get_path(species, "states"), where));
-
-    if (result->HasError()) {
-        throw cpptrace::runtime_error("Error querying the database: " + result->GetError());
-    }
+    // Look up the described state in the in-memory index of the states
+    auto matches = get_states_index(species)->find(description);
 
-    if (result->RowCount() == 0) {
+    if (matches.empty()) {
         throw std::invalid_argument("No state found.");
     }
 
-    // Check the types of the columns
-    const auto &types = result->types;
-    const auto &labels = result->names;
-    const std::vector<duckdb::LogicalType> ref_types = {
-        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::BIGINT,
-        duckdb::LogicalType::BIGINT,  duckdb::LogicalType::BIGINT,  duckdb::LogicalType::DOUBLE,
-        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,
-        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,
-        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,
-        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,
-        duckdb::LogicalType::BOOLEAN, duckdb::LogicalType::BOOLEAN, duckdb::LogicalType::DOUBLE};
-
-    for (size_t i = 0; i < types.size(); i++) {
-        if (types[i] != ref_types[i]) {
-            throw std::runtime_error("Wrong type for '" + labels[i] + "'. Got " +
-                                     types[i].ToString() + " but expected " +
-                                     ref_types[i].ToString());
-        }
-    }
-
-    // Get the first chunk of the results (the first chunk is sufficient as we need two rows at
-    // most)
-    auto chunk = result->Fetch();
+    auto create_ket = [&](const StatesIndex::State &state) {
+        return KetAtom(typename KetAtom::Private(), state.energy, state.quantum_number_f,
+                       description.quantum_number_m.value(), static_cast<Parity>(state.parity),
+                       species, static_cast<int>(state.quantum_number_n), state.quantum_number_nu,
+                       state.quantum_number_nui_exp, state.quantum_number_nui_std,
+                       state.quantum_number_l_exp, state.quantum_number_l_std,
+                       state.quantum_number_s_exp, state.quantum_number_s_std,
+                       state.quantum_number_j_exp, state.quantum_number_j_std,
+                       state.quantum_number_l_ryd_exp, state.quantum_number_l_ryd_std,
+                       state.quantum_number_j_ryd_exp, state.quantum_number_j_ryd_std,
+                       state.is_j_total_momentum, state.is_calculated_with_mqdt, *this,
+                       utils::get_linearized_id_in_database(
+                           state.id, description.quantum_number_m.value()));
+    };
 
     // Check that the ket is uniquely specified
-    if (chunk->size() > 1) {
-        auto order_val_0 = duckdb::FlatVector::GetData<double>(chunk->data[20])[0];
-        auto order_val_1 = duckdb::FlatVector::GetData<double>(chunk->data[20])[1];
+    if (matches.size() > 1) {
+        auto order_val_0 = matches[0].order_val;
+        auto order_val_1 = matches[1].order_val;
 
         if (order_val_1 - order_val_0 <= order_val_0) {
-            // Get a list of possible kets
-            std::vector<KetAtom> kets;
-            kets.reserve(2);
-            for (size_t i = 0; i < 2; ++i) {
-                auto result_quantum_number_m = description.quantum_number_m.value();
-                auto result_energy = duckdb::FlatVector::GetData<double>(chunk->data[0])[i];
-                auto result_quantum_number_f =
-                    duckdb::FlatVector::GetData<double>(chunk->data[1])[i];
-                auto result_parity = duckdb::FlatVector::GetData<int64_t>(chunk->data[2])[i];
-                auto result_id = utils::get_linearized_id_in_database(
-                    duckdb::FlatVector::GetData<int64_t>(chunk->data[3])[i],
-                    result_quantum_number_m);
-                auto result_quantum_number_n =
-                    duckdb::FlatVector::GetData<int64_t>(chunk->data[4])[i];
-                auto result_quantum_number_nu =
-                    duckdb::FlatVector::GetData<double>(chunk->data[5])[i];
-                auto result_quantum_number_nui_exp =
-                    duckdb::FlatVector::GetData<double>(chunk->data[6])[i];
-                auto result_quantum_number_nui_std =
-                    duckdb::FlatVector::GetData<double>(chunk->data[7])[i];
-                auto result_quantum_number_l_exp =
-                    duckdb::FlatVector::GetData<double>(chunk->data[8])[i];
-                auto result_quantum_number_l_std =
-                    duckdb::FlatVector::GetData<double>(chunk->data[9])[i];
-                auto result_quantum_number_s_exp =
-                    duckdb::FlatVector::GetData<double>(chunk->data[10])[i];
-                auto result_quantum_number_s_std =
-                    duckdb::FlatVector::GetData<double>(chunk->data[11])[i];
-                auto result_quantum_number_j_exp =
-                    duckdb::FlatVector::GetData<double>(chunk->data[12])[i];
-                auto result_quantum_number_j_std =
-                    duckdb::FlatVector::GetData<double>(chunk->data[13])[i];
-                auto result_quantum_number_l_ryd_exp =
-                    duckdb::FlatVector::GetData<double>(chunk->data[14])[i];
-                auto result_quantum_number_l_ryd_std =
-                    duckdb::FlatVector::GetData<double>(chunk->data[15])[i];
-                auto result_quantum_number_j_ryd_exp =
-                    duckdb::FlatVector::GetData<double>(chunk->data[16])[i];
-                auto result_quantum_number_j_ryd_std =
-                    duckdb::FlatVector::GetData<double>(chunk->data[17])[i];
-                auto result_is_j_total_momentum =
-                    duckdb::FlatVector::GetData<bool>(chunk->data[18])[i];
-                auto result_is_calculated_with_mqdt =
-                    duckdb::FlatVector::GetData<bool>(chunk->data[19])[i];
-                kets.emplace_back(
-                    typename KetAtom::Private(), result_energy, result_quantum_number_f,
-                    result_quantum_number_m, static_cast<Parity>(result_parity), species,
-                    result_quantum_number_n, result_quantum_number_nu,
-                    result_quantum_number_nui_exp, result_quantum_number_nui_std,
-                    result_quantum_number_l_exp, result_quantum_number_l_std,
-                    result_quantum_number_s_exp, result_quantum_number_s_std,
-                    result_quantum_number_j_exp, result_quantum_number_j_std,
-                    result_quantum_number_l_ryd_exp, result_quantum_number_l_ryd_std,
-                    result_quantum_number_j_ryd_exp, result_quantum_number_j_ryd_std,
-                    result_is_j_total_momentum, result_is_calculated_with_mqdt, *this, result_id);
-            }
-
             // Throw an error with the possible kets
             throw std::invalid_argument(
                 fmt::format("The ket is not uniquely specified. Possible kets are:\n{}\n{}",
-                            fmt::streamed(kets[0]), fmt::streamed(kets[1])));
+                            fmt::streamed(create_ket(*matches[0].state)),
+                            fmt::streamed(create_ket(*matches[1].state))));
         }
     }
 
-    // Construct the state
-    auto result_quantum_number_m = description.quantum_number_m.value();
-    auto result_energy = duckdb::FlatVector::GetData<double>(chunk->data[0])[0];
-    auto result_quantum_number_f = duckdb::FlatVector::GetData<double>(chunk->data[1])[0];
-    auto result_parity = duckdb::FlatVector::GetData<int64_t>(chunk->data[2])[0];
-    auto result_id = utils::get_linearized_id_in_database(
-        duckdb::FlatVector::GetData<int64_t>(chunk->data[3])[0], result_quantum_number_m);
-    auto result_quantum_number_n = duckdb::FlatVector::GetData<int64_t>(chunk->data[4])[0];
-    auto result_quantum_number_nu = duckdb::FlatVector::GetData<double>(chunk->data[5])[0];
-    auto result_quantum_number_nui_exp = duckdb::FlatVector::GetData<double>(chunk->data[6])[0];
-    auto result_quantum_number_nui_std = duckdb::FlatVector::GetData<double>(chunk->data[7])[0];
-    auto result_quantum_number_l_exp = duckdb::FlatVector::GetData<double>(chunk->data[8])[0];
-    auto result_quantum_number_l_std = duckdb::FlatVector::GetData<double>(chunk->data[9])[0];
-    auto result_quantum_number_s_exp = duckdb::FlatVector::GetData<double>(chunk->data[10])[0];
-    auto result_quantum_number_s_std = duckdb::FlatVector::GetData<double>(chunk->data[11])[0];
-    auto result_quantum_number_j_exp = duckdb::FlatVector::GetData<double>(chunk->data[12])[0];
-    auto result_quantum_number_j_std = duckdb::FlatVector::GetData<double>(chunk->data[13])[0];
-    auto result_quantum_number_l_ryd_exp = duckdb::FlatVector::GetData<double>(chunk->data[14])[0];
-    auto result_quantum_number_l_ryd_std = duckdb::FlatVector::GetData<double>(chunk->data[15])[0];
-    auto result_quantum_number_j_ryd_exp = duckdb::FlatVector::GetData<double>(chunk->data[16])[0];
-    auto result_quantum_number_j_ryd_std = duckdb::FlatVector::GetData<double>(chunk->data[17])[0];
-    auto result_is_j_total_momentum = duckdb::FlatVector::GetData<bool>(chunk->data[18])[0];
-    auto result_is_calculated_with_mqdt = duckdb::FlatVector::GetData<bool>(chunk->data[19])[0];
-
     // Check the quantum number m
-    if (std::abs(result_quantum_number_m) > result_quantum_number_f) {
+    const auto &state = *matches[0].state;
+    auto result_quantum_number_m = description.quantum_number_m.value();
+    if (std::abs(result_quantum_number_m) > state.quantum_number_f) {
         throw std::invalid_argument(
             "The absolute value of the quantum number m must be less than or equal to f.");
     }
-    if (result_quantum_number_f + result_quantum_number_m !=
-        std::rint(result_quantum_number_f + result_quantum_number_m)) {
+    if (state.quantum_number_f + result_quantum_number_m !=
+        std::rint(state.quantum_number_f + result_quantum_number_m)) {
         throw std::invalid_argument(
             "The quantum numbers f and m must be both either integers or half-integers.");
     }
 
 #ifndef NDEBUG
     // Check database consistency
-    if (result_is_j_total_momentum && result_quantum_number_f != result_quantum_number_j_exp) {
+    if (state.is_j_total_momentum && state.quantum_number_f != state.quantum_number_j_exp) {
         throw std::runtime_error("If j is the total momentum, f must be equal to j.");
     }
 #endif
 
-    return std::make_shared<const KetAtom>(
-        typename KetAtom::Private(), result_energy, result_quantum_number_f,
-        result_quantum_number_m, static_cast<Parity>(result_parity), species,
-        result_quantum_number_n, result_quantum_number_nu, result_quantum_number_nui_exp,
-        result_quantum_number_nui_std, result_quantum_number_l_exp, result_quantum_number_l_std,
-        result_quantum_number_s_exp, result_quantum_number_s_std, result_quantum_number_j_exp,
-        result_quantum_number_j_std, result_quantum_number_l_ryd_exp,
-        result_quantum_number_l_ryd_std, result_quantum_number_j_ryd_exp,
-        result_quantum_number_j_ryd_std, result_is_j_total_momentum, result_is_calculated_with_mqdt,
-        *this, result_id);
+    auto ket = std::make_shared<const KetAtom>(create_ket(state));
+    std::lock_guard<std::mutex> lock(mtx_kets);
+    return kets.emplace(ket_key, ket).first->second;
 }
 
 template <typename Scalar>
 std::shared_ptr<const BasisAtom<Scalar>>
 Database::get_basis(const std::string &species, const AtomDescriptionByRanges &description,
                     std::vector<size_t> additional_ket_ids) {
+    return get_basis_without_checks<Scalar>(species, description, std::move(additional_ket_ids),
+                                            nullptr);
+}
+
+template <typename Scalar>
+std::shared_ptr<const BasisAtom<Scalar>>
+Database::extend_basis(std::shared_ptr<const BasisAtom<Scalar>> basis,
+                       const AtomDescriptionByRanges &description,
+                       std::vector<size_t> additional_ket_ids) {
+    if (&basis->get_database() != this) {
+        throw std::invalid_argument("The basis to be extended must stem from this database.");
+    }
+
+    // A restricted basis has no table of kets in the database, thus its kets are added by id
+    if (basis->parent_basis) {
+        for (const auto &ket : basis->get_kets()) {
+            additional_ket_ids.push_back(ket->get_id_in_database());
+        }
+        return get_basis_without_checks<Scalar>(basis->get_species(), description,
+                                                std::move(additional_ket_ids), nullptr);
+    }
+
+    return get_basis_without_checks<Scalar>(basis->get_species(), description,
+                                            std::move(additional_ket_ids), basis);
+}
+
+template <typename Scalar>
+std::shared_ptr<const BasisAtom<Scalar>>
+Database::get_basis_without_checks(const std::string &species,
+                                   const AtomDescriptionByRanges &description,
+                                   std::vector<size_t> additional_ket_ids,
+                                   std::shared_ptr<const BasisAtom<Scalar>> parent_basis) {
     // Describe the states
     std::string where = "(";
     std::string separator;
@@ -544,6 +392,11 @@ Database::get_basis(const std::string &species, const AtomDescriptionByRanges &d
         where += fmt::format(" OR {} IN ({})", utils::SQL_TERM_FOR_LINEARIZED_ID_IN_DATABASE,
                              fmt::join(additional_ket_ids, ","));
     }
+    if (parent_basis) {
+        where += fmt::format(" OR {} IN (SELECT ketid FROM '{}')",
+                             utils::SQL_TERM_FOR_LINEARIZED_ID_IN_DATABASE,
+                             parent_basis->get_id_of_kets());
+    }
 
     // Create a table containing the described states
     std::string id_of_kets;
@@ -889,8 +742,28 @@ Database::get_basis(const std::string &species, const AtomDescriptionByRanges &d
         }
     }
 
-    return std::make_shared<const BasisAtom<Scalar>>(typename BasisAtom<Scalar>::Private(),
-                                                     std::move(kets), std::move(id_of_kets), *this);
+    auto basis = std::make_shared<const BasisAtom<Scalar>>(
+        typename BasisAtom<Scalar>::Private(), std::move(kets), std::move(id_of_kets), *this);
+
+    // Remember which kets the basis shares with the basis it extends so that the matrix elements
+    // between these kets can be reused
+    if (parent_basis) {
+        BasisExtension extension;
+        extension.parent_id_of_kets = parent_basis->get_id_of_kets();
+        extension.parent_to_child_index.reserve(parent_basis->get_number_of_kets());
+        for (const auto &ket : parent_basis->get_kets()) {
+            extension.parent_to_child_index.push_back(
+                basis->get_ket_index_from_id(ket->get_id_in_database()));
+        }
+        basis_extensions.emplace(basis->get_id_of_kets(), std::move(extension));
+    }
+
+    // Start computing the operators that are typically needed next in the background
+    if (prefetch_operators_) {
+        this->prefetch_matrix_elements(basis);
+    }
+
+    return basis;
 }
 
 template <typename Scalar>
@@ -898,6 +771,90 @@ Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
 Database::get_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> initial_basis,
                               std::shared_ptr<const BasisAtom<Scalar>> final_basis,
                               OperatorType type, int q) {
+    // If the operator is being prefetched, wait for the background task or, if it has not started
+    // yet, take over its work
+    std::string prefetch_key = get_prefetch_key(initial_basis->get_id_of_kets(), type, q);
+    std::shared_ptr<PrefetchTask> task;
+    if (initial_basis->get_id_of_kets() == final_basis->get_id_of_kets()) {
+        std::lock_guard<std::mutex> lock(mtx_prefetch_tasks);
+        auto it = prefetch_tasks.find(prefetch_key);
+        if (it != prefetch_tasks.end()) {
+            task = it->second;
+        }
+    }
+    if (task) {
+        if (task->claimed.exchange(true)) {
+            task->done.wait();
+        } else {
+            try {
+                // The work is isolated so that the thread does not pick up another task while
+                // waiting for parallel work, which could wait for this very prefetch task
+                auto matrix = oneapi::tbb::this_task_arena::isolate([&]() {
+                    return get_matrix_elements_without_prefetch(initial_basis, final_basis, type,
+                                                                q);
+                });
+                complete_prefetch_task(prefetch_key, *task);
+                return matrix;
+            } catch (...) {
+                complete_prefetch_task(prefetch_key, *task);
+                throw;
+            }
+        }
+    }
+
+    return get_matrix_elements_without_prefetch(initial_basis, final_basis, type, q);
+}
+
+template <typename Scalar>
+void Database::prefetch_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> basis) {
+    const std::vector<std::pair<OperatorType, int>> types_and_kappas = {
+        {OperatorType::ELECTRIC_DIPOLE, 1},
+        {OperatorType::ELECTRIC_QUADRUPOLE, 2},
+        {OperatorType::ELECTRIC_QUADRUPOLE_ZERO, 0},
+        {OperatorType::MAGNETIC_DIPOLE, 1}};
+
+    for (const auto &[type, kappa] : types_and_kappas) {
+        for (int q = -kappa; q <= kappa; q++) {
+            auto key = get_prefetch_key(basis->get_id_of_kets(), type, q);
+            auto task = std::make_shared<PrefetchTask>();
+            {
+                std::lock_guard<std::mutex> lock(mtx_prefetch_tasks);
+                prefetch_tasks.emplace(key, task);
+            }
+            prefetch_task_group.run([this, basis, type = type, q, key, task]() {
+                if (task->claimed.exchange(true)) {
+                    return;
+                }
+                try {
+                    oneapi::tbb::this_task_arena::isolate(
+                        [&]() { get_matrix_elements_without_prefetch(basis, basis, type, q); });
+                } catch (const std::exception &e) {
+                    // The error is raised again if the operator is actually requested
+                    SPDLOG_DEBUG("Prefetching an operator failed: {}", e.what());
+                }
+                complete_prefetch_task(key, *task);
+            });
+        }
+    }
+}
+
+void Database::complete_prefetch_task(const std::string &key, PrefetchTask &task) {
+    // Forget the task once it is completed, afterwards the operator is read from the cache
+    {
+        std::lock_guard<std::mutex> lock(mtx_prefetch_tasks);
+        prefetch_tasks.erase(key);
+    }
+    task.promise.set_value();
+}
+
+std::string Database::get_prefetch_key(const std::string &id_of_kets, OperatorType type, int q) {
+    return fmt::format("{}_{}_{}", static_cast<int>(type), q, id_of_kets);
+}
+
+template <typename Scalar>
+Eigen::SparseMatrix<Scalar, Eigen::RowMajor> Database::get_matrix_elements_without_prefetch(
+    std::shared_ptr<const BasisAtom<Scalar>> initial_basis,
+    std::shared_ptr<const BasisAtom<Scalar>> final_basis, OperatorType type, int q) {
     using real_t = typename traits::NumTraits<Scalar>::real_t;
 
     std::string specifier;
@@ -942,9 +899,52 @@ Database::get_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> initial_b
     std::string id_of_kets = initial_basis->get_id_of_kets();
     std::string cache_key = fmt::format("{}_{}_{}", specifier, q, id_of_kets);
 
+    // If the basis is a restriction of another basis, slice the operator of the other basis
+    if (get_matrix_elements_cache().count(cache_key) == 0 && initial_basis->parent_basis) {
+        const auto &parent_basis = initial_basis->parent_basis;
+        const auto &parent_ket_indices = *initial_basis->parent_ket_indices;
+        get_matrix_elements_without_prefetch(parent_basis, parent_basis, type, q);
+        const auto &parent_matrix = get_matrix_elements_cache().at(
+            fmt::format("{}_{}_{}", specifier, q, parent_basis->get_id_of_kets()));
+
+        std::vector<int> parent_to_child_index(parent_basis->get_number_of_kets(), -1);
+        for (size_t i = 0; i < parent_ket_indices.size(); ++i) {
+            parent_to_child_index[parent_ket_indices[i]] = static_cast<int>(i);
+        }
+
+        auto dim = static_cast<Eigen::Index>(parent_ket_indices.size());
+        std::vector<Eigen::Triplet<real_t>> triplets;
+        for (Eigen::Index row = 0; row < dim; ++row) {
+            for (typename Eigen::SparseMatrix<real_t, Eigen::RowMajor>::InnerIterator it(
+                     parent_matrix, static_cast<Eigen::Index>(parent_ket_indices[row]));
+                 it; ++it) {
+                if (int col = parent_to_child_index[it.col()]; col >= 0) {
+                    triplets.emplace_back(row, col, it.value());
+                }
+            }
+        }
+        Eigen::SparseMatrix<real_t, Eigen::RowMajor> matrix(dim, dim);
+        matrix.setFromTriplets(triplets.begin(), triplets.end());
+        get_matrix_elements_cache().emplace(cache_key, std::move(matrix));
+    }
+
     if (get_matrix_elements_cache().count(cache_key) == 0) {
         Eigen::Index dim = initial_basis->get_number_of_kets();
 
+        // If the basis extends a basis for which the operator is cached, only the matrix elements
+        // that involve new kets must be queried and the others are spliced in from the cache
+        const BasisExtension *extension = nullptr;
+        std::string parent_cache_key;
+        bool is_queried = specifier != "identity" && specifier != "energy" && !use_native_index_;
+        if (auto it = basis_extensions.find(id_of_kets);
+            is_queried && it != basis_extensions.end()) {
+            parent_cache_key =
+                fmt::format("{}_{}_{}", specifier, q, it->second.parent_id_of_kets);
+            if (get_matrix_elements_cache().count(parent_cache_key) > 0) {
+                extension = &it->second;
+            }
+        }
+
         std::vector<int> outerIndexPtr;
         std::vector<int> innerIndices;
         std::vector<real_t> values;
@@ -961,6 +961,108 @@ Database::get_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> initial_b
             }
             outerIndexPtr.push_back(static_cast<int>(innerIndices.size()));
 
+        } else if (use_native_index_ && specifier != "energy") {
+            // Check that the specifications are valid
+            if (std::abs(q) > kappa) {
+                throw std::invalid_argument("Invalid q.");
+            }
+
+            // Get the in-memory index of the reduced matrix elements
+            auto index = get_matrix_elements_index(initial_basis->get_species(), specifier);
+
+            // Get the angular parts of the matrix elements, keyed by the quantum numbers
+            auto get_key = [](double f_initial, double m_initial, double f_final, double m_final) {
+                auto to_bits = [](double x) {
+                    return static_cast<uint64_t>(std::lround(2 * x) + utils::OFFSET) & 0xFFFF;
+                };
+                return (to_bits(f_initial) << 48) | (to_bits(m_initial) << 32) |
+                    (to_bits(f_final) << 16) | to_bits(m_final);
+            };
+            std::unordered_map<uint64_t, double> wigner;
+            {
+                auto result = con->Query(fmt::format(
+                    R"(SELECT f_initial::DOUBLE, m_initial::DOUBLE, f_final::DOUBLE, m_final::DOUBLE, val::DOUBLE FROM '{}' WHERE kappa = {} AND q = {})",
+                    manager->get_path("misc", "wigner"), kappa, q));
+                if (result->HasError()) {
+                    throw cpptrace::runtime_error("Error querying the database: " +
+                                                  result->GetError());
+                }
+                for (auto chunk = result->Fetch(); chunk; chunk = result->Fetch()) {
+                    auto *chunk_f_initial = duckdb::FlatVector::GetData<double>(chunk->data[0]);
+                    auto *chunk_m_initial = duckdb::FlatVector::GetData<double>(chunk->data[1]);
+                    auto *chunk_f_final = duckdb::FlatVector::GetData<double>(chunk->data[2]);
+                    auto *chunk_m_final = duckdb::FlatVector::GetData<double>(chunk->data[3]);
+                    auto *chunk_val = duckdb::FlatVector::GetData<double>(chunk->data[4]);
+                    for (size_t i = 0; i < chunk->size(); i++) {
+                        wigner[get_key(chunk_f_initial[i], chunk_m_initial[i], chunk_f_final[i],
+                                       chunk_m_final[i])] = chunk_val[i];
+                    }
+                }
+            }
+
+            // Collect the ids and quantum numbers of the kets and sort the ket indices by id so
+            // that all kets belonging to a state can be found by a binary search
+            const auto &kets = initial_basis->get_kets();
+            std::vector<int64_t> ids(dim);
+            std::vector<double> quantum_numbers_f(dim);
+            std::vector<double> quantum_numbers_m(dim);
+            for (Eigen::Index i = 0; i < dim; i++) {
+                ids[i] =
+                    static_cast<int64_t>(kets[i]->get_id_in_database() / (2 * utils::OFFSET));
+                quantum_numbers_f[i] = kets[i]->get_quantum_number_f();
+                quantum_numbers_m[i] = kets[i]->get_quantum_number_m();
+            }
+            std::vector<std::pair<int64_t, int>> sorted_ids(dim);
+            for (Eigen::Index i = 0; i < dim; i++) {
+                sorted_ids[i] = {ids[i], static_cast<int>(i)};
+            }
+            std::sort(sorted_ids.begin(), sorted_ids.end());
+
+            // Look up the entries of each column in parallel
+            std::vector<std::vector<std::pair<int, real_t>>> entries_per_col(dim);
+            oneapi::tbb::parallel_for(
+                oneapi::tbb::blocked_range<Eigen::Index>(0, dim), [&](const auto &range) {
+                    for (Eigen::Index col = range.begin(); col != range.end(); ++col) {
+                        auto &entries = entries_per_col[col];
+                        index->for_each_entry(ids[col], [&](int64_t id_final, double value) {
+                            auto it = std::lower_bound(sorted_ids.begin(), sorted_ids.end(),
+                                                       std::make_pair(id_final, -1));
+                            for (; it != sorted_ids.end() && it->first == id_final; ++it) {
+                                int row = it->second;
+                                auto w = wigner.find(
+                                    get_key(quantum_numbers_f[col], quantum_numbers_m[col],
+                                            quantum_numbers_f[row], quantum_numbers_m[row]));
+                                if (w != wigner.end()) {
+                                    entries.emplace_back(row, value * w->second);
+                                }
+                            }
+                        });
+                    }
+                });
+
+            // Construct the matrix
+            std::vector<int> num_entries_per_row(dim, 0);
+            for (const auto &entries : entries_per_col) {
+                for (const auto &entry : entries) {
+                    num_entries_per_row[entry.first]++;
+                }
+            }
+            outerIndexPtr.resize(dim + 1);
+            outerIndexPtr[0] = 0;
+            for (Eigen::Index row = 0; row < dim; row++) {
+                outerIndexPtr[row + 1] = outerIndexPtr[row] + num_entries_per_row[row];
+            }
+            innerIndices.resize(outerIndexPtr[dim]);
+            values.resize(outerIndexPtr[dim]);
+            std::vector<int> position(outerIndexPtr.begin(), outerIndexPtr.end() - 1);
+            for (Eigen::Index col = 0; col < dim; col++) {
+                for (const auto &[row, val] : entries_per_col[col]) {
+                    innerIndices[position[row]] = static_cast<int>(col);
+                    values[position[row]] = val;
+                    position[row]++;
+                }
+            }
+
         } else {
             // Check that the specifications are valid
             if (std::abs(q) > kappa) {
@@ -971,13 +1073,106 @@ Database::get_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> initial_b
             std::string species = initial_basis->get_species();
             duckdb::unique_ptr<duckdb::MaterializedQueryResult> result;
             if (specifier != "energy") {
+                // Get the ids of the kets so that only the relevant rows of the matrix elements
+                // table must be read and cached
+                std::vector<int64_t> ids;
+                {
+                    auto result_ids = con->Query(fmt::format(
+                        R"(SELECT DISTINCT id::BIGINT FROM '{}' ORDER BY id ASC)", id_of_kets));
+                    if (result_ids->HasError()) {
+                        throw cpptrace::runtime_error("Error querying the ids: " +
+                                                      result_ids->GetError());
+                    }
+                    ids.reserve(result_ids->RowCount());
+                    for (auto chunk = result_ids->Fetch(); chunk; chunk = result_ids->Fetch()) {
+                        auto *chunk_ids = duckdb::FlatVector::GetData<int64_t>(chunk->data[0]);
+                        ids.insert(ids.end(), chunk_ids, chunk_ids + chunk->size());
+                    }
+                }
+                // If there are no ids, the range of ids is empty and there is nothing to cache
+                int64_t min_id = ids.empty() ? 1 : ids.front();
+                int64_t max_id = ids.empty() ? 0 : ids.back();
+
+                // If the rows of the matrix elements table are sorted by id_initial, split the ids
+                // into ranges at the largest gaps. Filtering by these ranges allows the row groups
+                // of the table that lie in the gaps to be skipped.
+                std::vector<std::pair<int64_t, int64_t>> id_ranges;
+                if (!ids.empty()) {
+                    id_ranges.emplace_back(min_id, max_id);
+                }
+                auto sort_columns = manager->get_sort_columns(species, specifier);
+                if (!ids.empty() && !sort_columns.empty() &&
+                    sort_columns.front() == "id_initial") {
+                    constexpr size_t max_number_of_ranges = 32;
+                    std::vector<size_t> gaps;
+                    for (size_t i = 1; i < ids.size(); i++) {
+                        if (ids[i] - ids[i - 1] > 1) {
+                            gaps.push_back(i);
+                        }
+                    }
+                    size_t number_of_splits = std::min(gaps.size(), max_number_of_ranges - 1);
+                    std::partial_sort(gaps.begin(), gaps.begin() + number_of_splits, gaps.end(),
+                                      [&ids](size_t a, size_t b) {
+                                          return ids[a] - ids[a - 1] > ids[b] - ids[b - 1];
+                                      });
+                    gaps.resize(number_of_splits);
+                    std::sort(gaps.begin(), gaps.end());
+
+                    id_ranges.clear();
+                    size_t begin = 0;
+                    for (size_t split : gaps) {
+                        id_ranges.emplace_back(ids[begin], ids[split - 1]);
+                        begin = split;
+                    }
+                    id_ranges.emplace_back(ids[begin], ids.back());
+                }
+
+                std::string where_initial = id_ranges.empty() ? "FALSE" : "";
+                std::string where_final = id_ranges.empty() ? "FALSE" : "";
+                std::string separator;
+                for (const auto &[lower, upper] : id_ranges) {
+                    where_initial +=
+                        separator + fmt::format("id_initial BETWEEN {} AND {}", lower, upper);
+                    where_final +=
+                        separator + fmt::format("id_final BETWEEN {} AND {}", lower, upper);
+                    separator = " OR ";
+                }
+
+                // If matrix elements are reused, only the rows that involve a state of a new ket
+                // are read before joining, and the pairs of reused kets are excluded afterwards
+                std::string where_new = "TRUE";
+                std::string where_not_reused = "TRUE";
+                if (extension != nullptr) {
+                    std::vector<bool> is_reused(dim, false);
+                    for (int index : extension->parent_to_child_index) {
+                        is_reused[index] = true;
+                    }
+                    std::vector<int64_t> new_ids;
+                    const auto &kets = initial_basis->get_kets();
+                    for (Eigen::Index i = 0; i < dim; i++) {
+                        if (!is_reused[i]) {
+                            new_ids.push_back(static_cast<int64_t>(kets[i]->get_id_in_database() /
+                                                                   (2 * utils::OFFSET)));
+                        }
+                    }
+                    std::sort(new_ids.begin(), new_ids.end());
+                    new_ids.erase(std::unique(new_ids.begin(), new_ids.end()), new_ids.end());
+
+                    where_new = new_ids.empty()
+                        ? "FALSE"
+                        : fmt::format("(id_initial IN ({0}) OR id_final IN ({0}))",
+                                      fmt::join(new_ids, ", "));
+                    where_not_reused = fmt::format("NOT (s1.ketid IN (SELECT ketid FROM '{0}') AND "
+                                                   "s2.ketid IN (SELECT ketid FROM '{0}'))",
+                                                   extension->parent_id_of_kets);
+                }
+
                 result = con->Query(fmt::format(
                     R"(WITH s AS (
                         SELECT id, f, m, ketid FROM '{}'
                     ),
                     b AS (
-                        SELECT MIN(f) AS min_f, MAX(f) AS max_f,
-                        MIN(id) AS min_id, MAX(id) AS max_id
+                        SELECT MIN(f) AS min_f, MAX(f) AS max_f
                         FROM s
                     ),
                     w_filtered AS (
@@ -990,9 +1185,7 @@ Database::get_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> initial_b
                     e_filtered AS (
                         SELECT *
                         FROM '{}'
-                        WHERE
-                        id_initial BETWEEN (SELECT min_id FROM b) AND (SELECT max_id FROM b) AND
-                        id_final BETWEEN (SELECT min_id FROM b) AND (SELECT max_id FROM b)
+                        WHERE ({}) AND ({}) AND {}
                     )
                     SELECT
                     s2.ketid AS row,
@@ -1004,9 +1197,11 @@ Database::get_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> initial_b
                     JOIN w_filtered AS w ON
                     w.f_initial = s1.f AND w.m_initial = s1.m AND
                     w.f_final = s2.f AND w.m_final = s2.m
+                    WHERE {}
                     ORDER BY row ASC, col ASC)",
                     id_of_kets, manager->get_path("misc", "wigner"), kappa, q,
-                    manager->get_path(species, specifier)));
+                    manager->get_path(species, specifier, "id_initial", min_id, max_id),
+                    where_initial, where_final, where_new, where_not_reused));
             } else {
                 result = con->Query(fmt::format(
                     R"(SELECT ketid as row, ketid as col, energy as val FROM '{}' ORDER BY row ASC)",
@@ -1066,13 +1261,36 @@ Database::get_matrix_elements(std::shared_ptr<const BasisAtom<Scalar>> initial_b
         Eigen::Map<const Eigen::SparseMatrix<real_t, Eigen::RowMajor>> matrix_map(
             dim, dim, values.size(), outerIndexPtr.data(), innerIndices.data(), values.data());
 
-        // Cache the matrix
-        get_matrix_elements_cache()[cache_key] = matrix_map;
+        // Cache the matrix, after splicing in the reused matrix elements if applicable. The matrix
+        // is inserted as a whole so that threads that read the cache concurrently, e.g., while
+        // operators are prefetched, never see a partially assigned matrix. If another thread
+        // inserted the same matrix in the meantime, the insertion has no effect.
+        if (extension != nullptr) {
+            const auto &parent_matrix = get_matrix_elements_cache().at(parent_cache_key);
+            const auto &parent_to_child_index = extension->parent_to_child_index;
+            std::vector<Eigen::Triplet<real_t>> triplets;
+            triplets.reserve(parent_matrix.nonZeros());
+            for (int row = 0; row < parent_matrix.outerSize(); ++row) {
+                for (typename Eigen::SparseMatrix<real_t, Eigen::RowMajor>::InnerIterator it(
+                         parent_matrix, row);
+                     it; ++it) {
+                    triplets.emplace_back(parent_to_child_index[it.row()],
+                                          parent_to_child_index[it.col()], it.value());
+                }
+            }
+            Eigen::SparseMatrix<real_t, Eigen::RowMajor> reused_matrix(dim, dim);
+            reused_matrix.setFromTriplets(triplets.begin(), triplets.end());
+            reused_matrix += matrix_map;
+            get_matrix_elements_cache().emplace(cache_key, std::move(reused_matrix));
+        } else {
+            get_matrix_elements_cache().emplace(
+                cache_key, Eigen::SparseMatrix<real_t, Eigen::RowMajor>(matrix_map));
+        }
     }
 
     // Construct the operator and return it
     return final_basis->get_coefficients().adjoint() *
-        get_matrix_elements_cache()[cache_key].template cast<Scalar>() *
+        get_matrix_elements_cache().at(cache_key).template cast<Scalar>() *
         initial_basis->get_coefficients();
 }
 
@@ -1080,6 +1298,53 @@ bool Database::get_download_missing() const { return download_missing_; }
 
 bool Database::get_use_cache() const { return use_cache_; }
 
+bool Database::get_use_persistent_store() const { return use_persistent_store_; }
+
+void Database::set_use_native_index(bool use_native_index) {
+    set_use_native_index(use_native_index, FloatType::FLOAT64);
+}
+
+void Database::set_use_native_index(bool use_native_index, FloatType float_type) {
+    use_native_index_ = use_native_index;
+    native_index_float_type_ = float_type;
+}
+
+bool Database::get_use_native_index() const { return use_native_index_; }
+
+void Database::set_prefetch_operators(bool prefetch_operators) {
+    prefetch_operators_ = prefetch_operators;
+}
+
+bool Database::get_prefetch_operators() const { return prefetch_operators_; }
+
+std::shared_ptr<const MatrixElementsIndex>
+Database::get_matrix_elements_index(const std::string &species, const std::string &specifier) {
+    FloatType float_type = native_index_float_type_;
+    std::string key = fmt::format("{}_{}_{}", species, specifier,
+                                  float_type == FloatType::FLOAT32 ? "float32" : "float64");
+    std::lock_guard<std::mutex> lock(mtx_matrix_elements_indices);
+    auto it = matrix_elements_indices.find(key);
+    if (it == matrix_elements_indices.end()) {
+        it = matrix_elements_indices
+                 .emplace(key, std::make_shared<const MatrixElementsIndex>(
+                                   *con, manager->get_path(species, specifier), float_type))
+                 .first;
+    }
+    return it->second;
+}
+
+std::shared_ptr<const StatesIndex> Database::get_states_index(const std::string &species) {
+    std::lock_guard<std::mutex> lock(mtx_states_indices);
+    auto it = states_indices.find(species);
+    if (it == states_indices.end()) {
+        it = states_indices
+                 .emplace(species, std::make_shared<const StatesIndex>(
+                                       *con, manager->get_path(species, "states")))
+                 .first;
+    }
+    return it->second;
+}
+
 std::filesystem::path Database::get_database_dir() const { return database_dir_; }
 
 oneapi::tbb::concurrent_unordered_map<std::string, Eigen::SparseMatrix<double, Eigen::RowMajor>> &
@@ -1159,6 +1424,9 @@ const std::filesystem::path Database::default_database_dir = database_dir_noexce
     template std::shared_ptr<const BasisAtom<SCALAR>> Database::get_basis<SCALAR>(                 \
         const std::string &species, const AtomDescriptionByRanges &description,                    \
         std::vector<size_t> additional_ket_ids);                                                   \
+    template std::shared_ptr<const BasisAtom<SCALAR>> Database::extend_basis<SCALAR>(              \
+        std::shared_ptr<const BasisAtom<SCALAR>> basis,                                            \
+        const AtomDescriptionByRanges &description, std::vector<size_t> additional_ket_ids);       \
     template Eigen::SparseMatrix<SCALAR, Eigen::RowMajor> Database::get_matrix_elements<SCALAR>(   \
         std::shared_ptr<const BasisAtom<SCALAR>> initial_basis,                                    \
         std::shared_ptr<const BasisAtom<SCALAR>> final_basis, OperatorType type, int q);
@@ -3,11 +3,15 @@
 #include "pairinteraction/basis/BasisAtom.hpp"
 #include "pairinteraction/database/AtomDescriptionByParameters.hpp"
 #include "pairinteraction/database/AtomDescriptionByRanges.hpp"
+#include "pairinteraction/enums/FloatType.hpp"
 #include "pairinteraction/enums/OperatorType.hpp"
 #include "pairinteraction/ket/KetAtom.hpp"
 #include "pairinteraction/operator/OperatorAtom.hpp"
 
 #include <doctest/doctest.h>
+#include <oneapi/tbb.h>
+#include <utility>
+#include <vector>
 
 namespace pairinteraction {
 DOCTEST_TEST_CASE("get a KetAtom") {
@@ -57,6 +61,26 @@ DOCTEST_TEST_CASE("uniquely specified ket") {
     DOCTEST_CHECK_NOTHROW(database.get_ket("Rb", description));
 }
 
+DOCTEST_TEST_CASE("memoized KetAtom") {
+    Database &database = Database::get_global_instance();
+
+    AtomDescriptionByParameters description;
+    description.quantum_number_n = 60;
+    description.quantum_number_l = 1;
+    description.quantum_number_j = 1.5;
+    description.quantum_number_m = 0.5;
+
+    auto ket1 = database.get_ket("Rb", description);
+    auto ket2 = database.get_ket("Rb", description);
+    DOCTEST_CHECK(ket1 == ket2);
+
+    description.quantum_number_m = -0.5;
+    auto ket3 = database.get_ket("Rb", description);
+    DOCTEST_CHECK(ket3 != ket1);
+    DOCTEST_CHECK(ket3->get_quantum_number_m() == -0.5);
+    DOCTEST_CHECK(ket3->get_energy() == ket1->get_energy());
+}
+
 DOCTEST_TEST_CASE("get a BasisAtom") {
     Database &database = Database::get_global_instance();
 
@@ -86,4 +110,100 @@ DOCTEST_TEST_CASE("get an OperatorAtom") {
     DOCTEST_MESSAGE("Number of basis states: ", basis->get_number_of_states());
     DOCTEST_MESSAGE("Number of non-zero entries: ", dipole.nonZeros());
 }
+
+DOCTEST_TEST_CASE("get an OperatorAtom using the native index") {
+    Database &global_database = Database::get_global_instance();
+    Database database(global_database.get_download_missing(), global_database.get_use_cache(),
+                      global_database.get_database_dir());
+
+    AtomDescriptionByRanges description;
+    description.range_quantum_number_n = {59, 61};
+    description.range_quantum_number_l = {0, 2};
+
+    for (auto [type, kappa] : {std::pair{OperatorType::ELECTRIC_DIPOLE, 1},
+                               std::pair{OperatorType::ELECTRIC_QUADRUPOLE, 2}}) {
+        for (int q = -kappa; q <= kappa; q++) {
+            database.set_use_native_index(false);
+            auto basis_query = database.get_basis<double>("Rb", description, {});
+            Eigen::MatrixXd reference =
+                database.get_matrix_elements<double>(basis_query, basis_query, type, q);
+
+            database.set_use_native_index(true);
+            auto basis_index = database.get_basis<double>("Rb", description, {});
+            Eigen::MatrixXd matrix =
+                database.get_matrix_elements<double>(basis_index, basis_index, type, q);
+
+            DOCTEST_CHECK((reference - matrix).norm() <= 1e-12 * reference.norm());
+
+            database.set_use_native_index(true, FloatType::FLOAT32);
+            auto basis_float = database.get_basis<double>("Rb", description, {});
+            Eigen::MatrixXd matrix_float =
+                database.get_matrix_elements<double>(basis_float, basis_float, type, q);
+
+            DOCTEST_CHECK((reference - matrix_float).cwiseAbs().maxCoeff() <=
+                          std::pow(2, -24) * reference.cwiseAbs().maxCoeff());
+        }
+    }
+}
+
+DOCTEST_TEST_CASE("get an OperatorAtom with prefetching") {
+    Database &global_database = Database::get_global_instance();
+    Database database(global_database.get_download_missing(), global_database.get_use_cache(),
+                      global_database.get_database_dir());
+
+    AtomDescriptionByRanges description;
+    description.range_quantum_number_n = {60, 60};
+    description.range_quantum_number_l = {0, 1};
+
+    auto basis_reference = database.get_basis<double>("Rb", description, {});
+    Eigen::MatrixXd reference = database.get_matrix_elements<double>(
+        basis_reference, basis_reference, OperatorType::ELECTRIC_DIPOLE, 1);
+
+    database.set_prefetch_operators(true);
+    auto basis = database.get_basis<double>("Rb", description, {});
+    Eigen::MatrixXd matrix =
+        database.get_matrix_elements<double>(basis, basis, OperatorType::ELECTRIC_DIPOLE, 1);
+
+    DOCTEST_CHECK((reference - matrix).norm() <= 1e-12 * reference.norm());
+}
+
+DOCTEST_TEST_CASE("get several OperatorAtoms concurrently with prefetching") {
+    Database &global_database = Database::get_global_instance();
+    Database database(global_database.get_download_missing(), global_database.get_use_cache(),
+                      global_database.get_database_dir());
+
+    AtomDescriptionByRanges description;
+    description.range_quantum_number_n = {59, 61};
+    description.range_quantum_number_l = {0, 2};
+
+    std::vector<std::pair<OperatorType, int>> operators;
+    for (auto [type, kappa] : {std::pair{OperatorType::ELECTRIC_DIPOLE, 1},
+                               std::pair{OperatorType::ELECTRIC_QUADRUPOLE, 2},
+                               std::pair{OperatorType::ELECTRIC_QUADRUPOLE_ZERO, 0}}) {
+        for (int q = -kappa; q <= kappa; q++) {
+            operators.emplace_back(type, q);
+        }
+    }
+
+    auto basis_reference = database.get_basis<double>("Rb", description, {});
+    std::vector<Eigen::MatrixXd> references;
+    for (const auto &[type, q] : operators) {
+        references.emplace_back(
+            database.get_matrix_elements<double>(basis_reference, basis_reference, type, q));
+    }
+
+    // Request the operators, and some of them twice, while they are prefetched in the background
+    database.set_prefetch_operators(true);
+    auto basis = database.get_basis<double>("Rb", description, {});
+    std::vector<Eigen::MatrixXd> matrices(2 * operators.size());
+    oneapi::tbb::parallel_for(size_t{0}, matrices.size(), [&](size_t i) {
+        const auto &[type, q] = operators[i % operators.size()];
+        matrices[i] = database.get_matrix_elements<double>(basis, basis, type, q);
+    });
+
+    for (size_t i = 0; i < matrices.size(); i++) {
+        const auto &reference = references[i % operators.size()];
+        DOCTEST_CHECK((reference - matrices[i]).norm() <= 1e-12 * reference.norm());
+    }
+}
 } // namespace pairinteraction
@@ -0,0 +1,81 @@
+#include "pairinteraction/database/MatrixElementsIndex.hpp"
+
+#include <cpptrace/cpptrace.hpp>
+#include <duckdb.hpp>
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace pairinteraction {
+MatrixElementsIndex::MatrixElementsIndex(duckdb::Connection &con, const std::string &path,
+                                         FloatType float_type) {
+    auto result = con.Query(fmt::format(
+        R"(SELECT id_initial::BIGINT, id_final::BIGINT, val::DOUBLE FROM '{}' ORDER BY id_initial ASC, id_final ASC)",
+        path));
+    if (result->HasError()) {
+        throw cpptrace::runtime_error("Error querying the matrix elements: " + result->GetError());
+    }
+
+    // Store the rows in flat arrays and record where the slice of each id_initial starts
+    size_t num_entries = result->RowCount();
+    encoded_ids_final.reserve(2 * num_entries);
+    if (float_type == FloatType::FLOAT32) {
+        values_float.reserve(num_entries);
+    } else {
+        values_double.reserve(num_entries);
+    }
+
+    size_t idx = 0;
+    uint32_t last_id_final = 0;
+    for (auto chunk = result->Fetch(); chunk; chunk = result->Fetch()) {
+        auto *chunk_id_initial = duckdb::FlatVector::GetData<int64_t>(chunk->data[0]);
+        auto *chunk_id_final = duckdb::FlatVector::GetData<int64_t>(chunk->data[1]);
+        auto *chunk_val = duckdb::FlatVector::GetData<double>(chunk->data[2]);
+
+        for (size_t i = 0; i < chunk->size(); i++, idx++) {
+            if (chunk_id_initial[i] < 0 || chunk_id_initial[i] > UINT32_MAX ||
+                chunk_id_final[i] < 0 || chunk_id_final[i] > UINT32_MAX) {
+                throw std::runtime_error("The ids of the matrix elements do not fit into 32 bits.");
+            }
+            auto id_initial = static_cast<uint32_t>(chunk_id_initial[i]);
+            auto id_final = static_cast<uint32_t>(chunk_id_final[i]);
+
+            if (ids_initial.empty() || ids_initial.back() != id_initial) {
+                ids_initial.push_back(id_initial);
+                offsets.push_back(idx);
+                byte_offsets.push_back(encoded_ids_final.size());
+                last_id_final = 0;
+            }
+
+            // Encode the difference to the previous id_final as a variable-length integer
+            uint32_t delta = id_final - last_id_final;
+            while (delta >= 0x80U) {
+                encoded_ids_final.push_back(static_cast<uint8_t>((delta & 0x7FU) | 0x80U));
+                delta >>= 7;
+            }
+            encoded_ids_final.push_back(static_cast<uint8_t>(delta));
+            last_id_final = id_final;
+
+            if (float_type == FloatType::FLOAT32) {
+                values_float.push_back(static_cast<float>(chunk_val[i]));
+            } else {
+                values_double.push_back(chunk_val[i]);
+            }
+        }
+    }
+    offsets.push_back(idx);
+    byte_offsets.push_back(encoded_ids_final.size());
+    encoded_ids_final.shrink_to_fit();
+
+    SPDLOG_DEBUG("Indexed {} matrix elements of {} initial states from {} using {} MB.", idx,
+                 ids_initial.size(), path, get_memory_usage() / 1e6);
+}
+
+size_t MatrixElementsIndex::get_number_of_entries() const { return offsets.back(); }
+
+size_t MatrixElementsIndex::get_memory_usage() const {
+    return ids_initial.size() * sizeof(uint32_t) +
+        (offsets.size() + byte_offsets.size()) * sizeof(size_t) + encoded_ids_final.size() +
+        values_double.size() * sizeof(double) + values_float.size() * sizeof(float);
+}
+} // namespace pairinteraction
@@ -3,11 +3,13 @@
 #include "pairinteraction/database/GitHubDownloader.hpp"
 #include "pairinteraction/version.hpp"
 
+#include <algorithm>
 #include <cpptrace/cpptrace.hpp>
 #include <ctime>
 #include <duckdb.hpp>
 #include <filesystem>
 #include <fmt/core.h>
+#include <fmt/ranges.h>
 #include <fstream>
 #include <future>
 #include <iomanip>
@@ -51,8 +53,14 @@ namespace pairinteraction {
 ParquetManager::ParquetManager(std::filesystem::path directory, const GitHubDownloader &downloader,
                                std::vector<std::string> repo_paths, duckdb::Connection &con,
                                bool use_cache)
+    : ParquetManager(std::move(directory), downloader, std::move(repo_paths), con, use_cache,
+                     false) {}
+
+ParquetManager::ParquetManager(std::filesystem::path directory, const GitHubDownloader &downloader,
+                               std::vector<std::string> repo_paths, duckdb::Connection &con,
+                               bool use_cache, bool use_persistent_store)
     : directory_(std::move(directory)), downloader(downloader), repo_paths_(std::move(repo_paths)),
-      con(con), use_cache_(use_cache) {
+      con(con), use_cache_(use_cache), use_persistent_store_(use_persistent_store) {
     // Ensure the local directory exists
     if (!std::filesystem::exists(directory_ / "tables")) {
         fs::create_directories(directory_ / "tables");
@@ -68,6 +76,11 @@ ParquetManager::ParquetManager(std::filesystem::path directory, const GitHubDown
                         rate_limit.remaining, format_time(rate_limit.reset_time));
         }
     }
+
+    // Attach the persistent store if it exists
+    if (use_persistent_store_) {
+        this->attach_store();
+    }
 }
 
 void ParquetManager::scan_remote() {
@@ -323,6 +336,14 @@ void ParquetManager::update_local_asset(const std::string &key) {
     mz_zip_reader_end(&zip_archive);
 }
 
+std::string ParquetManager::create_unique_table_name() {
+    auto result = con.Query(R"(SELECT UUID()::varchar)");
+    if (result->HasError()) {
+        throw cpptrace::runtime_error("Error selecting a unique table name: " + result->GetError());
+    }
+    return duckdb::FlatVector::GetData<duckdb::string_t>(result->Fetch()->data[0])[0].GetString();
+}
+
 void ParquetManager::cache_table(std::unordered_map<std::string, PathInfo>::iterator table_it) {
     // Check if the table is already cached
     {
@@ -340,31 +361,341 @@ void ParquetManager::cache_table(std::unordered_map<std::string, PathInfo>::iter
         return;
     }
 
-    // Cache the table in memory
-    std::string table_name;
-    {
-        auto result = con.Query(R"(SELECT UUID()::varchar)");
+    // Cache the table in memory, reusing the rows that are already cached
+    auto &info = table_it->second;
+    if (info.cached_ranges.empty()) {
+        std::string table_name = create_unique_table_name();
+        auto result = con.Query(fmt::format(R"(CREATE TEMP TABLE '{}' AS SELECT * FROM '{}')",
+                                            table_name, info.path));
         if (result->HasError()) {
-            throw cpptrace::runtime_error("Error selecting a unique table name: " +
-                                          result->GetError());
+            throw cpptrace::runtime_error("Error creating table: " + result->GetError());
+        }
+        info.source = info.path;
+        info.path = table_name;
+    } else {
+        std::string cached_where;
+        std::string separator;
+        for (const auto &[min_value, max_value] : info.cached_ranges) {
+            cached_where += separator +
+                fmt::format("{} BETWEEN {} AND {}", info.scope_column, min_value, max_value);
+            separator = " OR ";
+        }
+        auto result = con.Query(fmt::format(R"(INSERT INTO '{}' SELECT * FROM '{}' WHERE NOT ({}))",
+                                            info.path, info.source, cached_where));
+        if (result->HasError()) {
+            throw cpptrace::runtime_error("Error extending table: " + result->GetError());
         }
-        table_name =
-            duckdb::FlatVector::GetData<duckdb::string_t>(result->Fetch()->data[0])[0].GetString();
+        info.cached_ranges.clear();
     }
 
+    info.cached = true;
+}
+
+void ParquetManager::cache_table_range(std::unordered_map<std::string, PathInfo>::iterator table_it,
+                                       const std::string &column, int64_t min_value,
+                                       int64_t max_value) {
+    // Helper lambda returns the parts of [min_value, max_value] that are not cached yet
+    auto get_missing_ranges = [min_value, max_value](const PathInfo &info) {
+        std::vector<std::pair<int64_t, int64_t>> missing;
+        int64_t start = min_value;
+        for (const auto &[lower, upper] : info.cached_ranges) {
+            if (upper < start) {
+                continue;
+            }
+            if (lower > max_value) {
+                break;
+            }
+            if (lower > start) {
+                missing.emplace_back(start, lower - 1);
+            }
+            start = std::max(start, upper + 1);
+            if (start > max_value) {
+                break;
+            }
+        }
+        if (start <= max_value) {
+            missing.emplace_back(start, max_value);
+        }
+        return missing;
+    };
+
+    // Check if the range is already cached
     {
-        auto result = con.Query(fmt::format(R"(CREATE TEMP TABLE '{}' AS SELECT * FROM '{}')",
-                                            table_name, table_it->second.path));
+        std::shared_lock<std::shared_mutex> lock(mtx_local);
+        if (table_it->second.cached ||
+            (table_it->second.scope_column == column &&
+             get_missing_ranges(table_it->second).empty())) {
+            return;
+        }
+    }
+
+    // Acquire a unique lock for caching the range
+    std::unique_lock<std::shared_mutex> lock(mtx_local);
+
+    // Re-check because another thread might have cached the range
+    auto &info = table_it->second;
+    if (info.cached) {
+        return;
+    }
+
+    // A table can only be scoped by a single column, otherwise we fall back to caching everything
+    if (!info.scope_column.empty() && info.scope_column != column) {
+        lock.unlock();
+        cache_table(table_it);
+        return;
+    }
+
+    auto missing = get_missing_ranges(info);
+    if (missing.empty()) {
+        return;
+    }
+
+    // Materialize the missing rows in memory
+    std::string where;
+    std::string separator;
+    for (const auto &[lower, upper] : missing) {
+        where += separator + fmt::format("{} BETWEEN {} AND {}", column, lower, upper);
+        separator = " OR ";
+    }
+
+    if (info.cached_ranges.empty()) {
+        std::string table_name = create_unique_table_name();
+        auto result =
+            con.Query(fmt::format(R"(CREATE TEMP TABLE '{}' AS SELECT * FROM '{}' WHERE {})",
+                                  table_name, info.path, where));
         if (result->HasError()) {
             throw cpptrace::runtime_error("Error creating table: " + result->GetError());
         }
+        info.source = info.path;
+        info.path = table_name;
+        info.scope_column = column;
+    } else {
+        auto result = con.Query(fmt::format(R"(INSERT INTO '{}' SELECT * FROM '{}' WHERE {})",
+                                            info.path, info.source, where));
+        if (result->HasError()) {
+            throw cpptrace::runtime_error("Error extending table: " + result->GetError());
+        }
+    }
+
+    SPDLOG_DEBUG("Cached {} range(s) of column {} from {}.", missing.size(), column, info.source);
+
+    // Merge the new ranges into the sorted list of disjoint cached ranges
+    info.cached_ranges.insert(info.cached_ranges.end(), missing.begin(), missing.end());
+    std::sort(info.cached_ranges.begin(), info.cached_ranges.end());
+    std::vector<std::pair<int64_t, int64_t>> merged;
+    for (const auto &range : info.cached_ranges) {
+        if (!merged.empty() && range.first <= merged.back().second + 1) {
+            merged.back().second = std::max(merged.back().second, range.second);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    info.cached_ranges = std::move(merged);
+}
+
+void ParquetManager::attach_store() {
+    store_asset_versions.clear();
+
+    auto store_file = directory_ / "tables.duckdb";
+    if (!fs::exists(store_file)) {
+        return;
+    }
+
+    // Re-attach the store because the file might have been replaced by another process
+    {
+        auto result = con.Query("DETACH DATABASE IF EXISTS pairinteraction_store");
+        if (result->HasError()) {
+            throw cpptrace::runtime_error("Error detaching the persistent store: " +
+                                          result->GetError());
+        }
+    }
+    {
+        auto result = con.Query(fmt::format(R"(ATTACH '{}' AS pairinteraction_store (READ_ONLY))",
+                                            store_file.string()));
+        if (result->HasError()) {
+            SPDLOG_WARN("Error attaching the persistent store {}: {}. The store will be rebuilt.",
+                        store_file.string(), result->GetError());
+            return;
+        }
+    }
+
+    // Read which versions of the assets are contained in the store
+    auto result =
+        con.Query(R"(SELECT key, version_minor::BIGINT FROM pairinteraction_store.assets)");
+    if (result->HasError()) {
+        SPDLOG_WARN("Error reading the persistent store {}: {}. The store will be rebuilt.",
+                    store_file.string(), result->GetError());
+        return;
+    }
+    for (auto chunk = result->Fetch(); chunk; chunk = result->Fetch()) {
+        auto *keys = duckdb::FlatVector::GetData<duckdb::string_t>(chunk->data[0]);
+        auto *versions = duckdb::FlatVector::GetData<int64_t>(chunk->data[1]);
+        for (size_t i = 0; i < chunk->size(); i++) {
+            store_asset_versions[keys[i].GetString()] = static_cast<int>(versions[i]);
+        }
+    }
+}
+
+void ParquetManager::build_store() {
+    // Write the store to a temporary file first so that processes that have the old store
+    // attached are not affected, and move it into place afterwards. Assets whose version is
+    // already contained in the old store are kept, so that only stale assets must be imported.
+    auto store_file = directory_ / "tables.duckdb";
+    auto tmp_file = directory_ / fmt::format("tables.duckdb.{}.tmp", create_unique_table_name());
+    SPDLOG_INFO("Building the persistent store {}", store_file.string());
+
+    bool reuse_store = !store_asset_versions.empty() && fs::exists(store_file);
+    if (reuse_store) {
+        fs::copy_file(store_file, tmp_file);
+    }
+
+    try {
+        duckdb::DuckDB store_db(tmp_file.string());
+        duckdb::Connection store_con(store_db);
+
+        auto query = [&store_con](const std::string &sql) {
+            auto result = store_con.Query(sql);
+            if (result->HasError()) {
+                throw cpptrace::runtime_error("Error building the persistent store: " +
+                                              result->GetError());
+            }
+            return result;
+        };
+
+        if (!reuse_store) {
+            query(R"(CREATE TABLE assets (key VARCHAR, version_minor INTEGER))");
+        }
+
+        for (const auto &[key, asset] : local_asset_info) {
+            auto store_it = store_asset_versions.find(key);
+            if (reuse_store && store_it != store_asset_versions.end()) {
+                if (store_it->second == asset.version_minor) {
+                    continue;
+                }
+
+                // Drop the tables of the stale version of the asset
+                auto prefix = fmt::format("{}_v{}.{}_", key, COMPATIBLE_DATABASE_VERSION_MAJOR,
+                                          store_it->second);
+                auto result = query(fmt::format(
+                    R"(SELECT table_name FROM duckdb_tables() WHERE starts_with(table_name, '{}'))",
+                    prefix));
+                for (auto chunk = result->Fetch(); chunk; chunk = result->Fetch()) {
+                    auto *names = duckdb::FlatVector::GetData<duckdb::string_t>(chunk->data[0]);
+                    for (size_t i = 0; i < chunk->size(); i++) {
+                        query(fmt::format(R"(DROP TABLE "{}")", names[i].GetString()));
+                    }
+                }
+                query(fmt::format(R"(DELETE FROM assets WHERE key = '{}')", key));
+            }
+
+            for (const auto &[table, info] : asset.paths) {
+                const std::string &source = info.source.empty() ? info.path : info.source;
+                std::string name = fmt::format("{}_v{}.{}_{}", key,
+                                               COMPATIBLE_DATABASE_VERSION_MAJOR,
+                                               asset.version_minor, table);
+
+                // Sort the rows by the columns that are used for filtering so that the zone maps
+                // of the row groups allow for skipping irrelevant rows
+                auto columns = query(fmt::format(R"(SELECT * FROM '{}' LIMIT 0)", source))->names;
+                auto has_column = [&columns](const std::string &column) {
+                    return std::find(columns.begin(), columns.end(), column) != columns.end();
+                };
+                std::vector<std::string> sort_columns;
+                if (has_column("id_initial") && has_column("id_final")) {
+                    sort_columns = {"id_initial", "id_final"};
+                } else if (has_column("id")) {
+                    sort_columns = {"id"};
+                } else if (has_column("kappa") && has_column("q")) {
+                    sort_columns = {"kappa", "q"};
+                }
+
+                if (sort_columns.empty()) {
+                    query(fmt::format(R"(CREATE TABLE "{}" AS SELECT * FROM '{}')", name, source));
+                } else {
+                    query(fmt::format(R"(CREATE TABLE "{}" AS SELECT * FROM '{}' ORDER BY {})",
+                                      name, source, fmt::join(sort_columns, ", ")));
+                    query(fmt::format(R"(CREATE INDEX "{}_idx" ON "{}" ({}))", name, name,
+                                      fmt::join(sort_columns, ", ")));
+                }
+
+                // The states are additionally looked up by their quantum numbers
+                if (has_column("n") && has_column("exp_l")) {
+                    query(fmt::format(R"(CREATE INDEX "{}_quantum_numbers_idx" ON "{}" (n, exp_l))",
+                                      name, name));
+                }
+            }
+            query(fmt::format(R"(INSERT INTO assets VALUES ('{}', {}))", key, asset.version_minor));
+        }
+
+        query("CHECKPOINT");
+    } catch (...) {
+        std::error_code ec;
+        fs::remove(tmp_file, ec);
+        throw;
+    }
+
+    fs::rename(tmp_file, store_file);
+}
+
+void ParquetManager::use_table_from_store(
+    const std::string &key, std::unordered_map<std::string, PathInfo>::iterator table_it) {
+    // Check if the table is already taken from the store
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx_local);
+        if (table_it->second.cached) {
+            return;
+        }
+    }
+
+    // Acquire a unique lock for accessing the store
+    std::unique_lock<std::shared_mutex> lock(mtx_local);
+
+    // Re-check because another thread might have set up the table
+    if (table_it->second.cached) {
+        return;
+    }
+
+    // (Re-)build the store if it does not contain the current version of the asset. Another
+    // process might have done this already, so we attach the store first.
+    int version_minor = local_asset_info.at(key).version_minor;
+    auto is_up_to_date = [&]() {
+        auto it = store_asset_versions.find(key);
+        return it != store_asset_versions.end() && it->second == version_minor;
+    };
+    if (!is_up_to_date()) {
+        this->attach_store();
+    }
+    if (!is_up_to_date()) {
+        try {
+            this->build_store();
+        } catch (const std::exception &e) {
+            SPDLOG_WARN("Failed to build the persistent store: {}. Reading the table from {}.",
+                        e.what(), table_it->second.path);
+            return;
+        }
+        this->attach_store();
+    }
+    if (!is_up_to_date()) {
+        throw std::runtime_error("The persistent store does not contain the table " + key + "_" +
+                                 table_it->first + ".");
     }
 
-    table_it->second.path = table_name;
+    // Create a view on the table in the store
+    std::string view_name = create_unique_table_name();
+    auto result = con.Query(fmt::format(
+        R"(CREATE TEMP VIEW '{}' AS SELECT * FROM pairinteraction_store."{}_v{}.{}_{}")",
+        view_name, key, COMPATIBLE_DATABASE_VERSION_MAJOR, version_minor, table_it->first));
+    if (result->HasError()) {
+        throw cpptrace::runtime_error("Error creating view: " + result->GetError());
+    }
+
+    table_it->second.source = table_it->second.path;
+    table_it->second.path = view_name;
     table_it->second.cached = true;
 }
 
-std::string ParquetManager::get_path(const std::string &key, const std::string &table) {
+std::unordered_map<std::string, ParquetManager::PathInfo>::iterator
+ParquetManager::get_table_it(const std::string &key, const std::string &table) {
     // Update the local table if a newer version is available remotely
     this->update_local_asset(key);
 
@@ -377,9 +708,17 @@ std::string ParquetManager::get_path(const std::string &key, const std::string &
     if (table_it == asset_it->second.paths.end()) {
         throw std::runtime_error("Table " + key + "_" + table + " not found.");
     }
+    return table_it;
+}
+
+std::string ParquetManager::get_path(const std::string &key, const std::string &table) {
+    auto table_it = this->get_table_it(key, table);
 
-    // Cache the local table in memory if requested
-    if (use_cache_) {
+    // Read the table from the persistent store if requested, otherwise cache the local table in
+    // memory if requested
+    if (use_persistent_store_) {
+        this->use_table_from_store(key, table_it);
+    } else if (use_cache_) {
         this->cache_table(table_it);
     }
 
@@ -387,6 +726,66 @@ std::string ParquetManager::get_path(const std::string &key, const std::string &
     return table_it->second.path;
 }
 
+std::string ParquetManager::get_path(const std::string &key, const std::string &table,
+                                     const std::string &column, int64_t min_value,
+                                     int64_t max_value) {
+    auto table_it = this->get_table_it(key, table);
+
+    // Read the table from the persistent store if requested, otherwise cache only the requested
+    // rows of the local table in memory if requested. An empty range, e.g., if the minimum and
+    // maximum of an empty set of values are NULL, leaves nothing to cache.
+    if (use_persistent_store_) {
+        this->use_table_from_store(key, table_it);
+    } else if (use_cache_ && min_value <= max_value) {
+        this->cache_table_range(table_it, column, min_value, max_value);
+    }
+
+    // Return the path to the local table file
+    return table_it->second.path;
+}
+
+std::vector<std::string> ParquetManager::get_sort_columns(const std::string &key,
+                                                          const std::string &table) {
+    auto table_it = this->get_table_it(key, table);
+
+    // Check if the sort columns are already known
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx_local);
+        if (table_it->second.sort_columns_known) {
+            return table_it->second.sort_columns;
+        }
+    }
+
+    // Acquire a unique lock for reading the metadata
+    std::unique_lock<std::shared_mutex> lock(mtx_local);
+
+    // Re-check because another thread might have read the metadata
+    auto &info = table_it->second;
+    if (info.sort_columns_known) {
+        return info.sort_columns;
+    }
+
+    // Read the sort columns from the key-value metadata of the parquet file
+    const std::string &source = info.source.empty() ? info.path : info.source;
+    auto result = con.Query(fmt::format(
+        R"(SELECT decode(value)::VARCHAR FROM parquet_kv_metadata('{}') WHERE decode(key) = 'sorted_by')",
+        source));
+    if (result->HasError()) {
+        SPDLOG_DEBUG("Error reading the metadata of {}: {}", source, result->GetError());
+    } else if (result->RowCount() > 0) {
+        std::istringstream iss(
+            duckdb::FlatVector::GetData<duckdb::string_t>(result->Fetch()->data[0])[0].GetString());
+        for (std::string column; std::getline(iss, column, ',');) {
+            if (!column.empty()) {
+                info.sort_columns.push_back(column);
+            }
+        }
+    }
+
+    info.sort_columns_known = true;
+    return info.sort_columns;
+}
+
 std::string ParquetManager::get_versions_info() const {
     // Helper lambda returns the version string if available
     auto get_version = [](const auto &map, const std::string &table) -> int {
@@ -6,6 +6,7 @@
 #include <doctest/doctest.h>
 #include <duckdb.hpp>
 #include <filesystem>
+#include <fmt/core.h>
 #include <fstream>
 #include <miniz.h>
 #include <nlohmann/json.hpp>
@@ -106,6 +107,171 @@ TEST_CASE("ParquetManager functionality with mocked downloader") {
     std::filesystem::remove_all(test_dir);
 }
 
+TEST_CASE("ParquetManager caches only the requested ranges of a table") {
+    MockDownloader downloader;
+    auto test_dir = std::filesystem::temp_directory_path() / "pairinteraction_test_db_ranges";
+    std::filesystem::create_directories(test_dir / "tables" / "misc_v1.0");
+    auto path = test_dir / "tables" / "misc_v1.0" / "matrix_elements.parquet";
+    duckdb::DuckDB db(nullptr);
+    duckdb::Connection con(db);
+
+    auto result = con.Query(fmt::format(
+        R"(COPY (SELECT i AS id_initial, i AS id_final, 1.0 AS val FROM range(100) t(i)) TO '{}'
+        (FORMAT PARQUET))",
+        path.string()));
+    REQUIRE(!result->HasError());
+
+    std::vector<std::string> repo_paths;
+    ParquetManager manager(test_dir, downloader, repo_paths, con, true);
+    manager.scan_local();
+
+    auto count_rows = [&con](const std::string &table) {
+        auto result = con.Query(fmt::format(R"(SELECT COUNT(*)::BIGINT FROM '{}')", table));
+        REQUIRE(!result->HasError());
+        return duckdb::FlatVector::GetData<int64_t>(result->Fetch()->data[0])[0];
+    };
+
+    // Only the requested range is cached
+    std::string table = manager.get_path("misc", "matrix_elements", "id_initial", 10, 19);
+    CHECK(table != path.string());
+    CHECK(count_rows(table) == 10);
+
+    // Overlapping ranges extend the cached subset without duplicating rows
+    CHECK(manager.get_path("misc", "matrix_elements", "id_initial", 15, 29) == table);
+    CHECK(count_rows(table) == 20);
+    manager.get_path("misc", "matrix_elements", "id_initial", 0, 29);
+    CHECK(count_rows(table) == 30);
+
+    // An empty range does not cache anything
+    CHECK(manager.get_path("misc", "matrix_elements", "id_initial", 50, 49) == table);
+    CHECK(count_rows(table) == 30);
+
+    // Requesting the whole table caches the remaining rows
+    CHECK(manager.get_path("misc", "matrix_elements") == table);
+    CHECK(count_rows(table) == 100);
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("ParquetManager detects the ordering of a table") {
+    MockDownloader downloader;
+    auto test_dir = std::filesystem::temp_directory_path() / "pairinteraction_test_db_sorted";
+    std::filesystem::create_directories(test_dir / "tables" / "misc_v1.0");
+    duckdb::DuckDB db(nullptr);
+    duckdb::Connection con(db);
+
+    auto result = con.Query(fmt::format(
+        R"(COPY (SELECT i AS id_initial, i AS id_final FROM range(10) t(i)) TO '{}'
+        (FORMAT PARQUET, KV_METADATA {{sorted_by: 'id_initial,id_final'}}))",
+        (test_dir / "tables" / "misc_v1.0" / "sorted.parquet").string()));
+    REQUIRE(!result->HasError());
+    result = con.Query(fmt::format(
+        R"(COPY (SELECT i AS id_initial, i AS id_final FROM range(10) t(i)) TO '{}'
+        (FORMAT PARQUET))",
+        (test_dir / "tables" / "misc_v1.0" / "unsorted.parquet").string()));
+    REQUIRE(!result->HasError());
+
+    std::vector<std::string> repo_paths;
+    ParquetManager manager(test_dir, downloader, repo_paths, con, true);
+    manager.scan_local();
+
+    std::vector<std::string> expected = {"id_initial", "id_final"};
+    CHECK(manager.get_sort_columns("misc", "sorted") == expected);
+    CHECK(manager.get_sort_columns("misc", "unsorted").empty());
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("ParquetManager reads tables from the persistent store") {
+    MockDownloader downloader;
+    auto test_dir = std::filesystem::temp_directory_path() / "pairinteraction_test_db_store";
+    std::filesystem::create_directories(test_dir / "tables" / "misc_v1.0");
+    auto path = test_dir / "tables" / "misc_v1.0" / "matrix_elements.parquet";
+
+    {
+        duckdb::DuckDB db(nullptr);
+        duckdb::Connection con(db);
+        auto result = con.Query(fmt::format(
+            R"(COPY (SELECT 99-i AS id_initial, i AS id_final, 1.0 AS val FROM range(100) t(i))
+            TO '{}' (FORMAT PARQUET))",
+            path.string()));
+        REQUIRE(!result->HasError());
+    }
+
+    // Two managers mimic two processes, the first one builds the store, the second one reuses it
+    for (int i = 0; i < 2; i++) {
+        duckdb::DuckDB db(nullptr);
+        duckdb::Connection con(db);
+        std::vector<std::string> repo_paths;
+        ParquetManager manager(test_dir, downloader, repo_paths, con, false, true);
+        manager.scan_local();
+
+        std::string table = manager.get_path("misc", "matrix_elements");
+        CHECK(table != path.string());
+        CHECK(std::filesystem::exists(test_dir / "tables.duckdb"));
+
+        auto result = con.Query(fmt::format(
+            R"(SELECT COUNT(*)::BIGINT, MIN(id_initial)::BIGINT FROM '{}')", table));
+        REQUIRE(!result->HasError());
+        auto chunk = result->Fetch();
+        CHECK(duckdb::FlatVector::GetData<int64_t>(chunk->data[0])[0] == 100);
+        CHECK(duckdb::FlatVector::GetData<int64_t>(chunk->data[1])[0] == 0);
+    }
+
+    std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("ParquetManager re-imports only stale assets into the persistent store") {
+    MockDownloader downloader;
+    auto test_dir = std::filesystem::temp_directory_path() / "pairinteraction_test_db_stale";
+    std::filesystem::create_directories(test_dir / "tables" / "misc_v1.0");
+    std::filesystem::create_directories(test_dir / "tables" / "Rb_v1.0");
+    auto path_misc = test_dir / "tables" / "misc_v1.0" / "matrix_elements.parquet";
+    auto path_rb = test_dir / "tables" / "Rb_v1.0" / "states.parquet";
+    auto path_rb_updated = test_dir / "tables" / "Rb_v1.1" / "states.parquet";
+
+    auto write_tables = [&](int number_of_rows, const std::filesystem::path &path_states) {
+        duckdb::DuckDB db(nullptr);
+        duckdb::Connection con(db);
+        auto result = con.Query(fmt::format(
+            R"(COPY (SELECT i AS id_initial, i AS id_final, 1.0 AS val FROM range({}) t(i))
+            TO '{}' (FORMAT PARQUET))",
+            number_of_rows, path_misc.string()));
+        REQUIRE(!result->HasError());
+        result = con.Query(fmt::format(
+            R"(COPY (SELECT i AS id, i AS n, 0 AS exp_l FROM range({}) t(i))
+            TO '{}' (FORMAT PARQUET))",
+            number_of_rows, path_states.string()));
+        REQUIRE(!result->HasError());
+    };
+
+    auto count_rows = [&](const std::string &key, const std::string &table) {
+        duckdb::DuckDB db(nullptr);
+        duckdb::Connection con(db);
+        std::vector<std::string> repo_paths;
+        ParquetManager manager(test_dir, downloader, repo_paths, con, false, true);
+        manager.scan_local();
+        auto result = con.Query(fmt::format(R"(SELECT COUNT(*)::BIGINT FROM '{}')",
+                                            manager.get_path(key, table)));
+        REQUIRE(!result->HasError());
+        return duckdb::FlatVector::GetData<int64_t>(result->Fetch()->data[0])[0];
+    };
+
+    // Build the store from the initial version of both assets
+    write_tables(100, path_rb);
+    CHECK(count_rows("Rb", "states") == 100);
+    CHECK(count_rows("misc", "matrix_elements") == 100);
+
+    // Update the Rb asset and modify the misc asset without changing its version, only the stale
+    // Rb asset is re-imported
+    std::filesystem::create_directories(test_dir / "tables" / "Rb_v1.1");
+    write_tables(50, path_rb_updated);
+    CHECK(count_rows("Rb", "states") == 50);
+    CHECK(count_rows("misc", "matrix_elements") == 100);
+
+    std::filesystem::remove_all(test_dir);
+}
+
 DOCTEST_TEST_CASE("ParquetManager functionality with github downloader") {
     if (!Database::get_global_instance().get_download_missing()) {
         DOCTEST_MESSAGE("Skipping test because download_missing is false.");
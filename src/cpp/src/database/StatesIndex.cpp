@@ -0,0 +1,209 @@
+#include "pairinteraction/database/StatesIndex.hpp"
+
+#include "pairinteraction/database/AtomDescriptionByParameters.hpp"
+#include "pairinteraction/enums/Parity.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cpptrace/cpptrace.hpp>
+#include <duckdb.hpp>
+#include <fmt/core.h>
+#include <limits>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace pairinteraction {
+StatesIndex::StatesIndex(duckdb::Connection &con, const std::string &path) {
+    auto result = con.Query(fmt::format(
+        R"(SELECT energy, f, parity, id, n, nu, exp_nui, std_nui, exp_l, std_l, exp_s, std_s,
+        exp_j, std_j, exp_l_ryd, std_l_ryd, exp_j_ryd, std_j_ryd, is_j_total_momentum, is_calculated_with_mqdt FROM '{}' ORDER BY n ASC, id ASC)",
+        path));
+    if (result->HasError()) {
+        throw cpptrace::runtime_error("Error querying the database: " + result->GetError());
+    }
+
+    // Check the types of the columns
+    const auto &types = result->types;
+    const auto &labels = result->names;
+    const std::vector<duckdb::LogicalType> ref_types = {
+        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::BIGINT,
+        duckdb::LogicalType::BIGINT,  duckdb::LogicalType::BIGINT,  duckdb::LogicalType::DOUBLE,
+        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,
+        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,
+        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,
+        duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,  duckdb::LogicalType::DOUBLE,
+        duckdb::LogicalType::BOOLEAN, duckdb::LogicalType::BOOLEAN};
+
+    for (size_t i = 0; i < types.size(); i++) {
+        if (types[i] != ref_types[i]) {
+            throw std::runtime_error("Wrong type for '" + labels[i] + "'. Got " +
+                                     types[i].ToString() + " but expected " +
+                                     ref_types[i].ToString());
+        }
+    }
+
+    states.reserve(result->RowCount());
+    for (auto chunk = result->Fetch(); chunk; chunk = result->Fetch()) {
+        auto *chunk_energy = duckdb::FlatVector::GetData<double>(chunk->data[0]);
+        auto *chunk_quantum_number_f = duckdb::FlatVector::GetData<double>(chunk->data[1]);
+        auto *chunk_parity = duckdb::FlatVector::GetData<int64_t>(chunk->data[2]);
+        auto *chunk_id = duckdb::FlatVector::GetData<int64_t>(chunk->data[3]);
+        auto *chunk_quantum_number_n = duckdb::FlatVector::GetData<int64_t>(chunk->data[4]);
+        auto *chunk_quantum_number_nu = duckdb::FlatVector::GetData<double>(chunk->data[5]);
+        auto *chunk_quantum_number_nui_exp = duckdb::FlatVector::GetData<double>(chunk->data[6]);
+        auto *chunk_quantum_number_nui_std = duckdb::FlatVector::GetData<double>(chunk->data[7]);
+        auto *chunk_quantum_number_l_exp = duckdb::FlatVector::GetData<double>(chunk->data[8]);
+        auto *chunk_quantum_number_l_std = duckdb::FlatVector::GetData<double>(chunk->data[9]);
+        auto *chunk_quantum_number_s_exp = duckdb::FlatVector::GetData<double>(chunk->data[10]);
+        auto *chunk_quantum_number_s_std = duckdb::FlatVector::GetData<double>(chunk->data[11]);
+        auto *chunk_quantum_number_j_exp = duckdb::FlatVector::GetData<double>(chunk->data[12]);
+        auto *chunk_quantum_number_j_std = duckdb::FlatVector::GetData<double>(chunk->data[13]);
+        auto *chunk_quantum_number_l_ryd_exp =
+            duckdb::FlatVector::GetData<double>(chunk->data[14]);
+        auto *chunk_quantum_number_l_ryd_std =
+            duckdb::FlatVector::GetData<double>(chunk->data[15]);
+        auto *chunk_quantum_number_j_ryd_exp =
+            duckdb::FlatVector::GetData<double>(chunk->data[16]);
+        auto *chunk_quantum_number_j_ryd_std =
+            duckdb::FlatVector::GetData<double>(chunk->data[17]);
+        auto *chunk_is_j_total_momentum = duckdb::FlatVector::GetData<bool>(chunk->data[18]);
+        auto *chunk_is_calculated_with_mqdt = duckdb::FlatVector::GetData<bool>(chunk->data[19]);
+
+        for (size_t i = 0; i < chunk->size(); i++) {
+            states.push_back({chunk_energy[i],
+                              chunk_quantum_number_f[i],
+                              chunk_parity[i],
+                              chunk_id[i],
+                              chunk_quantum_number_n[i],
+                              chunk_quantum_number_nu[i],
+                              chunk_quantum_number_nui_exp[i],
+                              chunk_quantum_number_nui_std[i],
+                              chunk_quantum_number_l_exp[i],
+                              chunk_quantum_number_l_std[i],
+                              chunk_quantum_number_s_exp[i],
+                              chunk_quantum_number_s_std[i],
+                              chunk_quantum_number_j_exp[i],
+                              chunk_quantum_number_j_std[i],
+                              chunk_quantum_number_l_ryd_exp[i],
+                              chunk_quantum_number_l_ryd_std[i],
+                              chunk_quantum_number_j_ryd_exp[i],
+                              chunk_quantum_number_j_ryd_std[i],
+                              chunk_is_j_total_momentum[i],
+                              chunk_is_calculated_with_mqdt[i]});
+        }
+    }
+
+    SPDLOG_DEBUG("Indexed {} states from {}.", states.size(), path);
+}
+
+std::vector<StatesIndex::Match>
+StatesIndex::find(const AtomDescriptionByParameters &description) const {
+    // Without any specified quantum number, no state is matched
+    if (!description.energy.has_value() && !description.quantum_number_f.has_value() &&
+        description.parity == Parity::UNKNOWN && !description.quantum_number_n.has_value() &&
+        !description.quantum_number_nu.has_value() && !description.quantum_number_nui.has_value() &&
+        !description.quantum_number_l.has_value() && !description.quantum_number_s.has_value() &&
+        !description.quantum_number_j.has_value() &&
+        !description.quantum_number_l_ryd.has_value() &&
+        !description.quantum_number_j_ryd.has_value()) {
+        return {};
+    }
+
+    // Restrict the search to the states with the specified quantum number n
+    auto begin = states.begin();
+    auto end = states.end();
+    if (description.quantum_number_n.has_value()) {
+        int64_t n = description.quantum_number_n.value();
+        begin = std::lower_bound(
+            states.begin(), states.end(), n,
+            [](const State &state, int64_t value) { return state.quantum_number_n < value; });
+        end = std::upper_bound(
+            begin, states.end(), n,
+            [](int64_t value, const State &state) { return value < state.quantum_number_n; });
+    }
+
+    // The condition on the energy derives from demanding that quantum number n that corresponds to
+    // the energy "E_n = -1/(2*n^2)" is not off by more than 1 from the actual quantum number n,
+    // i.e., "sqrt(-1/(2*E_n)) - sqrt(-1/(2*E_{n-1})) = 1"
+    std::optional<double> nu_of_energy;
+    if (description.energy.has_value()) {
+        nu_of_energy = std::sqrt(-1 / (2 * description.energy.value()));
+    }
+
+    auto is_within = [](double value, const std::optional<double> &target) {
+        return !target.has_value() ||
+            (value >= target.value() - 0.5 && value <= target.value() + 0.5);
+    };
+    auto add_squared_deviation = [](double &order_val, double value,
+                                    const std::optional<double> &target) {
+        if (target.has_value()) {
+            order_val += (value - target.value()) * (value - target.value());
+        }
+    };
+
+    // If no quantum number with an expectation value is specified, the states are ranked by id
+    bool is_ranked_by_id = !description.energy.has_value() &&
+        !description.quantum_number_nu.has_value() && !description.quantum_number_nui.has_value() &&
+        !description.quantum_number_l.has_value() && !description.quantum_number_s.has_value() &&
+        !description.quantum_number_j.has_value() &&
+        !description.quantum_number_l_ryd.has_value() &&
+        !description.quantum_number_j_ryd.has_value();
+
+    std::vector<Match> matches;
+    for (auto it = begin; it != end; ++it) {
+        const State &state = *it;
+        std::optional<double> state_nu_of_energy;
+        if (nu_of_energy.has_value()) {
+            state_nu_of_energy = std::sqrt(-1 / (2 * state.energy));
+        }
+
+        if ((nu_of_energy.has_value() && !is_within(state_nu_of_energy.value(), nu_of_energy)) ||
+            (description.quantum_number_f.has_value() &&
+             state.quantum_number_f != description.quantum_number_f.value()) ||
+            (description.parity != Parity::UNKNOWN &&
+             state.parity != static_cast<int64_t>(description.parity)) ||
+            !is_within(state.quantum_number_nu, description.quantum_number_nu) ||
+            !is_within(state.quantum_number_nui_exp, description.quantum_number_nui) ||
+            !is_within(state.quantum_number_l_exp, description.quantum_number_l) ||
+            !is_within(state.quantum_number_s_exp, description.quantum_number_s) ||
+            !is_within(state.quantum_number_j_exp, description.quantum_number_j) ||
+            !is_within(state.quantum_number_l_ryd_exp, description.quantum_number_l_ryd) ||
+            !is_within(state.quantum_number_j_ryd_exp, description.quantum_number_j_ryd)) {
+            continue;
+        }
+
+        double order_val = is_ranked_by_id ? static_cast<double>(state.id) : 0;
+        if (nu_of_energy.has_value()) {
+            add_squared_deviation(order_val, state_nu_of_energy.value(), nu_of_energy);
+        }
+        add_squared_deviation(order_val, state.quantum_number_nu, description.quantum_number_nu);
+        add_squared_deviation(order_val, state.quantum_number_nui_exp,
+                              description.quantum_number_nui);
+        add_squared_deviation(order_val, state.quantum_number_l_exp, description.quantum_number_l);
+        add_squared_deviation(order_val, state.quantum_number_s_exp, description.quantum_number_s);
+        add_squared_deviation(order_val, state.quantum_number_j_exp, description.quantum_number_j);
+        add_squared_deviation(order_val, state.quantum_number_l_ryd_exp,
+                              description.quantum_number_l_ryd);
+        add_squared_deviation(order_val, state.quantum_number_j_ryd_exp,
+                              description.quantum_number_j_ryd);
+
+        // Keep the two best matches
+        Match match{&state, order_val};
+        if (matches.size() < 2) {
+            matches.push_back(match);
+        } else if (order_val < matches.back().order_val) {
+            matches.back() = match;
+        } else {
+            continue;
+        }
+        if (matches.size() == 2 && matches[1].order_val < matches[0].order_val) {
+            std::swap(matches[0], matches[1]);
+        }
+    }
+
+    return matches;
+}
+
+size_t StatesIndex::get_number_of_states() const { return states.size(); }
+} // namespace pairinteraction
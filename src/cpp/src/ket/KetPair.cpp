@@ -6,22 +6,17 @@
 #include "pairinteraction/utils/hash.hpp"
 
 #include <limits>
+#include <stdexcept>
 #include <string>
 
 namespace pairinteraction {
 template <typename Scalar>
-KetPair<Scalar>::KetPair(
-    Private /*unused*/, std::initializer_list<size_t> atomic_indices,
-    std::initializer_list<std::shared_ptr<const BasisAtom<Scalar>>> atomic_bases, real_t energy)
+KetPair<Scalar>::KetPair(Private /*unused*/, atomic_indices_t atomic_indices,
+                         const atomic_bases_t *atomic_bases, real_t energy)
     : Ket(energy, calculate_quantum_number_f(atomic_indices, atomic_bases),
           calculate_quantum_number_m(atomic_indices, atomic_bases),
           calculate_parity(atomic_indices, atomic_bases)),
-      atomic_indices(atomic_indices), atomic_bases(atomic_bases) {
-    if (atomic_indices.size() != atomic_bases.size()) {
-        throw std::invalid_argument(
-            "The number of atomic indices, and atomic bases must be the same.");
-    }
-}
+      atomic_indices(atomic_indices), atomic_bases(atomic_bases) {}
 
 template <typename Scalar>
 std::string KetPair<Scalar>::get_label() const {
@@ -29,7 +24,7 @@ std::string KetPair<Scalar>::get_label() const {
     std::string separator;
     for (size_t atom_index = 0; atom_index < atomic_indices.size(); ++atom_index) {
         label += separator +
-            atomic_bases[atom_index]
+            (*atomic_bases)[atom_index]
                 ->get_corresponding_ket(atomic_indices[atom_index])
                 ->get_label();
         separator = "; ";
@@ -52,15 +47,21 @@ std::vector<std::shared_ptr<const BasisAtom<Scalar>>> KetPair<Scalar>::get_atomi
     std::vector<std::shared_ptr<const BasisAtom<Scalar>>> atomic_states;
     atomic_states.reserve(atomic_indices.size());
     for (size_t atom_index = 0; atom_index < atomic_indices.size(); ++atom_index) {
-        atomic_states.push_back(atomic_bases[atom_index]->get_state(atomic_indices[atom_index]));
+        atomic_states.push_back(
+            (*atomic_bases)[atom_index]->get_state(atomic_indices[atom_index]));
     }
     return atomic_states;
 }
 
+template <typename Scalar>
+const typename KetPair<Scalar>::atomic_indices_t &KetPair<Scalar>::get_atomic_indices() const {
+    return atomic_indices;
+}
+
 template <typename Scalar>
 bool KetPair<Scalar>::operator==(const KetPair<Scalar> &other) const {
     return Ket::operator==(other) && atomic_indices == other.atomic_indices &&
-        atomic_bases == other.atomic_bases;
+        (atomic_bases == other.atomic_bases || *atomic_bases == *other.atomic_bases);
 }
 
 template <typename Scalar>
@@ -74,7 +75,7 @@ size_t KetPair<Scalar>::hash::operator()(const KetPair<Scalar> &k) const {
     for (const auto &index : k.atomic_indices) {
         utils::hash_combine(seed, index);
     }
-    for (const auto &basis : k.atomic_bases) {
+    for (const auto &basis : *k.atomic_bases) {
         utils::hash_combine(seed, reinterpret_cast<std::uintptr_t>(basis.get()));
     }
     return seed;
@@ -82,32 +83,32 @@ size_t KetPair<Scalar>::hash::operator()(const KetPair<Scalar> &k) const {
 
 template <typename Scalar>
 typename KetPair<Scalar>::real_t KetPair<Scalar>::calculate_quantum_number_f(
-    const std::vector<size_t> & /*indices*/,
-    const std::vector<std::shared_ptr<const BasisAtom<Scalar>>> & /*bases*/) {
+    const atomic_indices_t & /*indices*/, const atomic_bases_t * /*bases*/) {
     // Because this ket state is not symmetrized, the quantum_number_f is not well-defined.
     return std::numeric_limits<real_t>::max();
 }
 
 template <typename Scalar>
 typename KetPair<Scalar>::real_t KetPair<Scalar>::calculate_quantum_number_m(
-    const std::vector<size_t> &indices,
-    const std::vector<std::shared_ptr<const BasisAtom<Scalar>>> &bases) {
-    for (const auto &basis : bases) {
+    const atomic_indices_t &indices, const atomic_bases_t *bases) {
+    if (!bases) {
+        throw std::invalid_argument("The atomic bases must be provided.");
+    }
+    for (const auto &basis : *bases) {
         if (!basis->has_quantum_number_m()) {
             return std::numeric_limits<real_t>::max();
         }
     }
     real_t total_quantum_number_m = 0;
     for (size_t i = 0; i < indices.size(); ++i) {
-        total_quantum_number_m += bases[i]->get_quantum_number_m(indices[i]);
+        total_quantum_number_m += (*bases)[i]->get_quantum_number_m(indices[i]);
     }
     return total_quantum_number_m;
 }
 
 template <typename Scalar>
-Parity KetPair<Scalar>::calculate_parity(
-    const std::vector<size_t> & /*indices*/,
-    const std::vector<std::shared_ptr<const BasisAtom<Scalar>>> & /*bases*/) {
+Parity KetPair<Scalar>::calculate_parity(const atomic_indices_t & /*indices*/,
+                                         const atomic_bases_t * /*bases*/) {
     // Because this ket state is not symmetrized, the parity is not well-defined.
     return Parity::UNKNOWN;
 }
@@ -18,6 +18,7 @@
 #include <numeric>
 #include <oneapi/tbb.h>
 #include <optional>
+#include <set>
 #include <spdlog/spdlog.h>
 
 namespace pairinteraction {
@@ -30,14 +31,16 @@ System<Derived>::System(const System &other)
     : hamiltonian(std::make_unique<typename System<Derived>::operator_t>(*other.hamiltonian)),
       hamiltonian_requires_construction(other.hamiltonian_requires_construction),
       hamiltonian_is_diagonal(other.hamiltonian_is_diagonal),
-      blockdiagonalizing_labels(other.blockdiagonalizing_labels) {}
+      blockdiagonalizing_labels(other.blockdiagonalizing_labels),
+      pending_eigenvectors(other.pending_eigenvectors) {}
 
 template <typename Derived>
 System<Derived>::System(System &&other) noexcept
     : hamiltonian(std::move(other.hamiltonian)),
       hamiltonian_requires_construction(other.hamiltonian_requires_construction),
       hamiltonian_is_diagonal(other.hamiltonian_is_diagonal),
-      blockdiagonalizing_labels(std::move(other.blockdiagonalizing_labels)) {}
+      blockdiagonalizing_labels(std::move(other.blockdiagonalizing_labels)),
+      pending_eigenvectors(std::move(other.pending_eigenvectors)) {}
 
 template <typename Derived>
 System<Derived> &System<Derived>::operator=(const System &other) {
@@ -46,6 +49,7 @@ System<Derived> &System<Derived>::operator=(const System &other) {
         hamiltonian_requires_construction = other.hamiltonian_requires_construction;
         hamiltonian_is_diagonal = other.hamiltonian_is_diagonal,
         blockdiagonalizing_labels = other.blockdiagonalizing_labels;
+        pending_eigenvectors = other.pending_eigenvectors;
     }
     return *this;
 }
@@ -57,6 +61,7 @@ System<Derived> &System<Derived>::operator=(System &&other) noexcept {
         hamiltonian_requires_construction = other.hamiltonian_requires_construction;
         hamiltonian_is_diagonal = other.hamiltonian_is_diagonal,
         blockdiagonalizing_labels = std::move(other.blockdiagonalizing_labels);
+        pending_eigenvectors = std::move(other.pending_eigenvectors);
     }
     return *this;
 }
@@ -70,20 +75,84 @@ const Derived &System<Derived>::derived() const {
 }
 
 template <typename Derived>
-std::shared_ptr<const typename System<Derived>::basis_t> System<Derived>::get_basis() const {
+void System<Derived>::construct_eigenbasis() const {
+    if (!pending_eigenvectors.has_value()) {
+        return;
+    }
+    const auto &blocks = *pending_eigenvectors;
+
+    // Count the non-zeros of each row, the blocks cover disjoint ranges of rows
+    Eigen::Index num_rows = 0;
+    Eigen::Index num_cols = 0;
+    for (const auto &block : blocks) {
+        num_rows += block.rows();
+        num_cols += block.cols();
+    }
+    Eigen::SparseMatrix<scalar_t, Eigen::RowMajor> eigenvectors(num_rows, num_cols);
+    int *outer = eigenvectors.outerIndexPtr();
+    oneapi::tbb::parallel_for(size_t{0}, blocks.size(), [&](size_t idx) {
+        const auto &block = blocks[idx];
+        for (Eigen::Index row = 0; row < block.rows(); ++row) {
+            outer[block.row_offset + row + 1] = block.is_dense
+                ? static_cast<int>((block.dense.row(row).array() != scalar_t(0)).count())
+                : block.sparse.outerIndexPtr()[row + 1] - block.sparse.outerIndexPtr()[row];
+        }
+    });
+    std::partial_sum(outer, outer + num_rows + 1, outer);
+    eigenvectors.resizeNonZeros(outer[num_rows]);
+
+    // Copy the entries of the blocks
+    oneapi::tbb::parallel_for(size_t{0}, blocks.size(), [&](size_t idx) {
+        const auto &block = blocks[idx];
+        for (Eigen::Index row = 0; row < block.rows(); ++row) {
+            int pos = outer[block.row_offset + row];
+            if (block.is_dense) {
+                for (Eigen::Index col = 0; col < block.cols(); ++col) {
+                    if (block.dense(row, col) != scalar_t(0)) {
+                        eigenvectors.innerIndexPtr()[pos] =
+                            static_cast<int>(block.col_offset + col);
+                        eigenvectors.valuePtr()[pos++] = block.dense(row, col);
+                    }
+                }
+            } else {
+                for (typename Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>::InnerIterator it(
+                         block.sparse, row);
+                     it; ++it) {
+                    eigenvectors.innerIndexPtr()[pos] =
+                        static_cast<int>(block.col_offset + it.col());
+                    eigenvectors.valuePtr()[pos++] = it.value();
+                }
+            }
+        }
+    });
+
+    hamiltonian->get_basis() = hamiltonian->get_basis()->transformed(
+        Transformation<scalar_t>(std::move(eigenvectors)));
+    pending_eigenvectors.reset();
+}
+
+template <typename Derived>
+void System<Derived>::update_hamiltonian(bool apply_pending_eigenvectors) const {
     if (hamiltonian_requires_construction) {
+        // The Hamiltonian is constructed in the basis of the last diagonalization
+        construct_eigenbasis();
         construct_hamiltonian();
         hamiltonian_requires_construction = false;
     }
+    if (apply_pending_eigenvectors) {
+        construct_eigenbasis();
+    }
+}
+
+template <typename Derived>
+std::shared_ptr<const typename System<Derived>::basis_t> System<Derived>::get_basis() const {
+    update_hamiltonian();
     return hamiltonian->get_basis();
 }
 
 template <typename Derived>
 std::shared_ptr<const typename System<Derived>::basis_t> System<Derived>::get_eigenbasis() const {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian();
     if (!hamiltonian_is_diagonal) {
         throw std::runtime_error("The Hamiltonian has not been diagonalized yet.");
     }
@@ -91,11 +160,43 @@ std::shared_ptr<const typename System<Derived>::basis_t> System<Derived>::get_ei
 }
 
 template <typename Derived>
-Eigen::VectorX<typename System<Derived>::real_t> System<Derived>::get_eigenvalues() const {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
+Eigen::VectorX<typename System<Derived>::real_t>
+System<Derived>::get_eigenbasis_overlaps(std::shared_ptr<const ket_t> ket) const {
+    update_hamiltonian(false);
+    if (!hamiltonian_is_diagonal) {
+        throw std::runtime_error("The Hamiltonian has not been diagonalized yet.");
+    }
+    // The overloads for kets are called explicitly because BasisPair hides them
+    const auto &basis = hamiltonian->get_basis();
+    if (!pending_eigenvectors.has_value()) {
+        return basis->Basis<basis_t>::get_overlaps(ket);
     }
+
+    // Only transform the amplitudes of the given ket instead of constructing the eigenbasis
+    Eigen::VectorX<scalar_t> amplitudes = basis->Basis<basis_t>::get_amplitudes(ket);
+    const auto &blocks = *pending_eigenvectors;
+    Eigen::Index num_cols = 0;
+    for (const auto &block : blocks) {
+        num_cols += block.cols();
+    }
+    Eigen::VectorX<real_t> overlaps(num_cols);
+    oneapi::tbb::parallel_for(size_t{0}, blocks.size(), [&](size_t idx) {
+        const auto &block = blocks[idx];
+        auto amplitudes_of_block = amplitudes.segment(block.row_offset, block.rows());
+        if (block.is_dense) {
+            overlaps.segment(block.col_offset, block.cols()) =
+                (block.dense.transpose() * amplitudes_of_block).cwiseAbs2();
+        } else {
+            overlaps.segment(block.col_offset, block.cols()) =
+                (block.sparse.transpose() * amplitudes_of_block).cwiseAbs2();
+        }
+    });
+    return overlaps;
+}
+
+template <typename Derived>
+Eigen::VectorX<typename System<Derived>::real_t> System<Derived>::get_eigenvalues() const {
+    update_hamiltonian(false);
     if (!hamiltonian_is_diagonal) {
         throw std::runtime_error("The Hamiltonian has not been diagonalized yet.");
     }
@@ -105,58 +206,40 @@ Eigen::VectorX<typename System<Derived>::real_t> System<Derived>::get_eigenvalue
 template <typename Derived>
 const Eigen::SparseMatrix<typename System<Derived>::scalar_t, Eigen::RowMajor> &
 System<Derived>::get_matrix() const {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian(false);
     return hamiltonian->get_matrix();
 }
 
 template <typename Derived>
 const Transformation<typename System<Derived>::scalar_t> &
 System<Derived>::get_transformation() const {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian();
     return hamiltonian->get_transformation();
 }
 
 template <typename Derived>
 Transformation<typename System<Derived>::scalar_t>
 System<Derived>::get_rotator(real_t alpha, real_t beta, real_t gamma) const {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian();
     return hamiltonian->get_rotator(alpha, beta, gamma);
 }
 
 template <typename Derived>
 Sorting System<Derived>::get_sorter(const std::vector<TransformationType> &labels) const {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian();
     return hamiltonian->get_sorter(labels);
 }
 
 template <typename Derived>
 std::vector<IndicesOfBlock>
 System<Derived>::get_indices_of_blocks(const std::vector<TransformationType> &labels) const {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian();
     return hamiltonian->get_indices_of_blocks(labels);
 }
 
 template <typename Derived>
 System<Derived> &System<Derived>::transform(const Transformation<scalar_t> &transformation) {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian();
     hamiltonian = std::make_unique<operator_t>(hamiltonian->transformed(transformation));
 
     // A transformed system might have lost its block-diagonalizability if the
@@ -168,10 +251,7 @@ System<Derived> &System<Derived>::transform(const Transformation<scalar_t> &tran
 
 template <typename Derived>
 System<Derived> &System<Derived>::transform(const Sorting &transformation) {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian();
     hamiltonian = std::make_unique<operator_t>(hamiltonian->transformed(transformation));
 
     return *this;
@@ -181,20 +261,19 @@ template <typename Derived>
 System<Derived> &System<Derived>::diagonalize(const DiagonalizerInterface<scalar_t> &diagonalizer,
                                               std::optional<real_t> min_eigenvalue,
                                               std::optional<real_t> max_eigenvalue, double atol) {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian(false);
 
     if (hamiltonian_is_diagonal) {
         return *this;
     }
 
-    Eigen::SparseMatrix<scalar_t, Eigen::RowMajor> eigenvectors;
     Eigen::SparseMatrix<scalar_t, Eigen::RowMajor> eigenvalues;
 
-    // Sort the Hamiltonian according to the block structure
-    if (!blockdiagonalizing_labels.empty()) {
+    // Sort the Hamiltonian according to the block structure, unless the states are already sorted,
+    // e.g., because the basis has been created in this order
+    std::set<TransformationType> unique_labels(blockdiagonalizing_labels.begin(),
+                                               blockdiagonalizing_labels.end());
+    if (!unique_labels.empty() && !hamiltonian->get_basis()->is_sorted_by(unique_labels)) {
         auto sorter = hamiltonian->get_sorter(blockdiagonalizing_labels);
         hamiltonian = std::make_unique<operator_t>(hamiltonian->transformed(sorter));
     }
@@ -227,87 +306,72 @@ System<Derived> &System<Derived>::diagonalize(const DiagonalizerInterface<scalar
             }
         });
 
-    // Get the number of non-zeros per row of the combined eigenvector matrix
-    std::vector<Eigen::Index> non_zeros_per_inner_index;
-    non_zeros_per_inner_index.reserve(hamiltonian->get_matrix().rows());
+    // Get the offsets of the blocks within the combined eigenvector matrix (in case of an
+    // restricted energy range, it is not square)
+    std::vector<EigenvectorBlock> blocks_of_eigenvectors(blocks.size());
     Eigen::Index num_rows = 0;
     Eigen::Index num_cols = 0;
-    for (const auto &matrix : eigenvectors_blocks) {
-        for (int i = 0; i < matrix.outerSize(); ++i) {
-            non_zeros_per_inner_index.push_back(matrix.outerIndexPtr()[i + 1] -
-                                                matrix.outerIndexPtr()[i]);
-        }
-        num_rows += matrix.rows();
-        num_cols += matrix.cols();
+    for (size_t idx = 0; idx < blocks.size(); ++idx) {
+        blocks_of_eigenvectors[idx].row_offset = num_rows;
+        blocks_of_eigenvectors[idx].col_offset = num_cols;
+        num_rows += eigenvectors_blocks[idx].rows();
+        num_cols += eigenvectors_blocks[idx].cols();
     }
 
     assert(static_cast<size_t>(num_rows) == hamiltonian->get_basis()->get_number_of_kets());
     assert(static_cast<size_t>(num_cols) <= hamiltonian->get_basis()->get_number_of_states());
 
-    eigenvectors.resize(num_rows, num_cols);
-    eigenvalues.resize(num_cols, num_cols);
-
-    if (num_cols > 0) {
-        // Get the combined eigenvector matrix (in case of an restricted energy range, it is not
-        // square)
-        eigenvectors.reserve(non_zeros_per_inner_index);
-        Eigen::Index offset_rows = 0;
-        Eigen::Index offset_cols = 0;
-        for (const auto &matrix : eigenvectors_blocks) {
-            for (Eigen::Index i = 0; i < matrix.outerSize(); ++i) {
-                for (typename Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>::InnerIterator it(
-                         matrix, i);
-                     it; ++it) {
-                    eigenvectors.insert(it.row() + offset_rows, it.col() + offset_cols) =
-                        it.value();
+    // Fix phase ambiguity and store the eigenvectors of each block densely if this takes less
+    // memory than sparse storage, which is usually the case as the eigenvectors mix all states of
+    // a block
+    oneapi::tbb::parallel_for(size_t{0}, blocks.size(), [&](size_t idx) {
+        auto &matrix = eigenvectors_blocks[idx];
+        auto &block = blocks_of_eigenvectors[idx];
+
+        if (matrix.cols() > 0) {
+            using iterator_t =
+                typename Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>::InnerIterator;
+            std::vector<scalar_t> map_col_to_max(matrix.cols(), 0);
+            for (int row = 0; row < matrix.outerSize(); ++row) {
+                for (iterator_t it(matrix, row); it; ++it) {
+                    if (std::abs(it.value()) > std::abs(map_col_to_max[it.col()])) {
+                        map_col_to_max[it.col()] = it.value();
+                    }
                 }
             }
-            offset_rows += matrix.rows();
-            offset_cols += matrix.cols();
-        }
-        eigenvectors.makeCompressed();
-
-        assert(
-            eigenvectors.nonZeros() ==
-            std::accumulate(non_zeros_per_inner_index.begin(), non_zeros_per_inner_index.end(), 0));
-
-        // Get the combined eigenvalue matrix
-        eigenvalues.reserve(Eigen::VectorXi::Constant(num_cols, 1));
-        Eigen::Index offset = 0;
-        for (const auto &matrix : eigenvalues_blocks) {
-            for (int i = 0; i < matrix.size(); ++i) {
-                eigenvalues.insert(i + offset, i + offset) = matrix(i);
-            }
-            offset += matrix.size();
-        }
-        eigenvalues.makeCompressed();
-
-        // Fix phase ambiguity
-        std::vector<scalar_t> map_col_to_max(num_cols, 0);
-        for (int row = 0; row < eigenvectors.outerSize(); ++row) {
-            for (typename Eigen::SparseMatrix<scalar_t, Eigen::RowMajor>::InnerIterator it(
-                     eigenvectors, row);
-                 it; ++it) {
-                if (std::abs(it.value()) > std::abs(map_col_to_max[it.col()])) {
-                    map_col_to_max[it.col()] = it.value();
+            for (int row = 0; row < matrix.outerSize(); ++row) {
+                for (iterator_t it(matrix, row); it; ++it) {
+                    it.valueRef() *= std::abs(map_col_to_max[it.col()]) / map_col_to_max[it.col()];
                 }
             }
         }
 
-        Eigen::SparseMatrix<scalar_t, Eigen::RowMajor> phase_matrix;
-        phase_matrix.resize(num_cols, num_cols);
-        phase_matrix.reserve(Eigen::VectorXi::Constant(num_cols, 1));
-        for (int i = 0; i < num_cols; ++i) {
-            phase_matrix.insert(i, i) = std::abs(map_col_to_max[i]) / map_col_to_max[i];
+        auto memory_sparse =
+            static_cast<size_t>(matrix.nonZeros()) * (sizeof(scalar_t) + sizeof(int));
+        auto memory_dense = static_cast<size_t>(matrix.rows() * matrix.cols()) * sizeof(scalar_t);
+        block.is_dense = memory_sparse >= memory_dense;
+        if (block.is_dense) {
+            block.dense = Eigen::MatrixX<scalar_t>(matrix);
+        } else {
+            block.sparse = std::move(matrix);
         }
-        phase_matrix.makeCompressed();
+    });
 
-        eigenvectors = eigenvectors * phase_matrix;
+    // Get the combined eigenvalue matrix
+    eigenvalues.resize(num_cols, num_cols);
+    eigenvalues.reserve(Eigen::VectorXi::Constant(num_cols, 1));
+    Eigen::Index offset = 0;
+    for (const auto &matrix : eigenvalues_blocks) {
+        for (int i = 0; i < matrix.size(); ++i) {
+            eigenvalues.insert(i + offset, i + offset) = matrix(i);
+        }
+        offset += matrix.size();
     }
+    eigenvalues.makeCompressed();
 
-    // Store the diagonalized hamiltonian
+    // Store the diagonalized hamiltonian, the eigenbasis is only constructed when it is accessed
     hamiltonian->get_matrix() = eigenvalues;
-    hamiltonian->get_basis() = hamiltonian->get_basis()->transformed(eigenvectors);
+    pending_eigenvectors = std::move(blocks_of_eigenvectors);
 
     hamiltonian_is_diagonal = true;
 
@@ -316,10 +380,7 @@ System<Derived> &System<Derived>::diagonalize(const DiagonalizerInterface<scalar
 
 template <typename Derived>
 bool System<Derived>::is_diagonal() const {
-    if (hamiltonian_requires_construction) {
-        construct_hamiltonian();
-        hamiltonian_requires_construction = false;
-    }
+    update_hamiltonian(false);
     return hamiltonian_is_diagonal;
 }
 
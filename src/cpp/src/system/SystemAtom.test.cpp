@@ -18,6 +18,7 @@
 namespace pairinteraction {
 
 constexpr double VOLT_PER_CM_IN_ATOMIC_UNITS = 1 / 5.14220675112e9;
+constexpr double GAUSS_IN_ATOMIC_UNITS = 1 / 2.35051757077e9;
 
 DOCTEST_TEST_CASE("construct and diagonalize a small Hamiltonian") {
     auto &database = Database::get_global_instance();
@@ -60,6 +61,87 @@ DOCTEST_TEST_CASE("construct and diagonalize a small Hamiltonian") {
     }
 }
 
+DOCTEST_TEST_CASE("get overlaps with the eigenbasis before it is constructed") {
+    auto &database = Database::get_global_instance();
+    auto diagonalizer = DiagonalizerEigen<std::complex<double>>();
+
+    auto basis = BasisAtomCreator<std::complex<double>>()
+                     .set_species("Rb")
+                     .restrict_quantum_number_n(59, 61)
+                     .restrict_quantum_number_l(0, 1)
+                     .create(database);
+    auto ket = basis->get_kets()[0];
+
+    auto system = SystemAtom<std::complex<double>>(basis);
+    system.set_electric_field({0.0001, 0, 0.0001});
+    system.diagonalize(diagonalizer);
+
+    // The first call uses the pending eigenvectors, the second call the constructed eigenbasis
+    Eigen::VectorXd overlaps_lazy = system.get_eigenbasis_overlaps(ket);
+    Eigen::VectorXd overlaps = system.get_eigenbasis()->get_overlaps(ket);
+    DOCTEST_CHECK((overlaps_lazy - overlaps).norm() < 1e-12);
+    DOCTEST_CHECK((system.get_eigenbasis_overlaps(ket) - overlaps).norm() < 1e-12);
+    DOCTEST_CHECK(std::abs(overlaps.sum() - 1) < 1e-10);
+}
+
+DOCTEST_TEST_CASE("get overlaps with the eigenbasis after diagonalizing in an energy range") {
+    auto &database = Database::get_global_instance();
+    auto diagonalizer = DiagonalizerEigen<double>();
+
+    auto basis = BasisAtomCreator<double>()
+                     .set_species("Rb")
+                     .restrict_quantum_number_n(59, 61)
+                     .restrict_quantum_number_l(0, 1)
+                     .create(database);
+    auto ket = basis->get_kets()[0];
+
+    auto system = SystemAtom<double>(basis);
+    system.set_magnetic_field({0, 0, 10 * GAUSS_IN_ATOMIC_UNITS});
+
+    DOCTEST_SUBCASE("sparse eigenvectors") {
+        // A magnetic field along the quantization axis only mixes states of the same m and l
+    }
+
+    DOCTEST_SUBCASE("dense eigenvectors") {
+        // The additional electric field mixes all states, so that the eigenvectors are dense
+        system.set_electric_field(
+            {1 * VOLT_PER_CM_IN_ATOMIC_UNITS, 0, 1 * VOLT_PER_CM_IN_ATOMIC_UNITS});
+    }
+
+    // Diagonalize the full Hamiltonian as a reference and choose an energy range that contains
+    // half of the eigenvalues
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigensolver;
+    eigensolver.compute(Eigen::MatrixXd(system.get_matrix()));
+    const auto &eigenvalues_all = eigensolver.eigenvalues();
+    Eigen::Index first = eigenvalues_all.size() / 4;
+    Eigen::Index size = eigenvalues_all.size() / 2;
+    double min_energy = (eigenvalues_all[first - 1] + eigenvalues_all[first]) / 2;
+    double max_energy = (eigenvalues_all[first + size - 1] + eigenvalues_all[first + size]) / 2;
+    Eigen::MatrixXd eigenvectors = eigensolver.eigenvectors().middleCols(first, size);
+
+    Eigen::VectorXd amplitudes = basis->get_amplitudes(ket);
+    Eigen::VectorXd overlaps_ref = (eigenvectors.transpose() * amplitudes).cwiseAbs2();
+    DOCTEST_CHECK(overlaps_ref.sum() > 0);
+
+    auto system_lazy = system;
+    system_lazy.diagonalize(diagonalizer, min_energy, max_energy, 1e-10);
+    auto system_eager = system;
+    system_eager.diagonalize(diagonalizer, min_energy, max_energy, 1e-10);
+
+    // Assemble the eigenbasis of one system before asking for the overlaps, so that only the
+    // other system calculates them from the pending eigenvectors
+    auto eigenbasis = system_eager.get_eigenbasis();
+    DOCTEST_CHECK(eigenbasis->get_number_of_states() == static_cast<size_t>(size));
+    Eigen::MatrixXd coefficients = eigenbasis->get_coefficients();
+    DOCTEST_CHECK((coefficients.cwiseAbs() - eigenvectors.cwiseAbs()).norm() < 1e-8);
+
+    Eigen::VectorXd overlaps_lazy = system_lazy.get_eigenbasis_overlaps(ket);
+    Eigen::VectorXd overlaps_eager = system_eager.get_eigenbasis_overlaps(ket);
+    DOCTEST_CHECK(overlaps_lazy.size() == size);
+    DOCTEST_CHECK((overlaps_lazy - overlaps_eager).norm() < 1e-12);
+    DOCTEST_CHECK((overlaps_lazy - overlaps_ref).norm() < 1e-8);
+}
+
 DOCTEST_TEST_CASE("construct and diagonalize two Hamiltonians in parallel") {
     auto &database = Database::get_global_instance();
     auto diagonalizer = DiagonalizerEigen<std::complex<double>>();
@@ -43,6 +43,41 @@ struct OperatorMatrices {
     std::vector<Eigen::SparseMatrix<Scalar, Eigen::RowMajor>> q2;
 };
 
+// A spherical component of a multipole operator, multiplied by a sign, in the order in which the
+// components are contracted with the Green functions
+struct OperatorComponent {
+    int sign;
+    OperatorType type;
+    int q;
+};
+
+constexpr std::array<OperatorComponent, 3> dipole_components1{{
+    {-1, OperatorType::ELECTRIC_DIPOLE, 1},
+    {1, OperatorType::ELECTRIC_DIPOLE, 0},
+    {-1, OperatorType::ELECTRIC_DIPOLE, -1},
+}};
+constexpr std::array<OperatorComponent, 3> dipole_components2{{
+    {1, OperatorType::ELECTRIC_DIPOLE, -1},
+    {1, OperatorType::ELECTRIC_DIPOLE, 0},
+    {1, OperatorType::ELECTRIC_DIPOLE, 1},
+}};
+constexpr std::array<OperatorComponent, 6> quadrupole_components1{{
+    {1, OperatorType::ELECTRIC_QUADRUPOLE, 2},
+    {-1, OperatorType::ELECTRIC_QUADRUPOLE, 1},
+    {1, OperatorType::ELECTRIC_QUADRUPOLE, 0},
+    {-1, OperatorType::ELECTRIC_QUADRUPOLE, -1},
+    {1, OperatorType::ELECTRIC_QUADRUPOLE, -2},
+    {1, OperatorType::ELECTRIC_QUADRUPOLE_ZERO, 0},
+}};
+constexpr std::array<OperatorComponent, 6> quadrupole_components2{{
+    {1, OperatorType::ELECTRIC_QUADRUPOLE, -2},
+    {1, OperatorType::ELECTRIC_QUADRUPOLE, -1},
+    {1, OperatorType::ELECTRIC_QUADRUPOLE, 0},
+    {1, OperatorType::ELECTRIC_QUADRUPOLE, 1},
+    {1, OperatorType::ELECTRIC_QUADRUPOLE, 2},
+    {1, OperatorType::ELECTRIC_QUADRUPOLE_ZERO, 0},
+}};
+
 template <typename Scalar>
 GreenFunctions<Scalar> construct_green_functions(
     const std::array<typename traits::NumTraits<Scalar>::real_t, 3> &distance_vector, int order) {
@@ -253,56 +288,35 @@ construct_operator_matrices(const GreenFunctions<Scalar> &green_functions,
                             const std::shared_ptr<const BasisAtom<Scalar>> &basis2) {
     OperatorMatrices<Scalar> op;
 
+    auto construct = [](const auto &basis, const auto &components) {
+        std::vector<Eigen::SparseMatrix<Scalar, Eigen::RowMajor>> matrices;
+        matrices.reserve(components.size());
+        for (const auto &component : components) {
+            matrices.push_back(static_cast<Scalar>(component.sign) *
+                               OperatorAtom<Scalar>(basis, component.type, component.q)
+                                   .get_matrix());
+        }
+        return matrices;
+    };
+
     if (green_functions.dipole_dipole.nonZeros() > 0 ||
         green_functions.dipole_quadrupole.nonZeros() > 0) {
-        op.d1.push_back(
-            -OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_DIPOLE, 1).get_matrix());
-        op.d1.push_back(
-            OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_DIPOLE, 0).get_matrix());
-        op.d1.push_back(
-            -OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_DIPOLE, -1).get_matrix());
+        op.d1 = construct(basis1, dipole_components1);
     }
 
     if (green_functions.dipole_dipole.nonZeros() > 0 ||
         green_functions.quadrupole_dipole.nonZeros() > 0) {
-        op.d2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_DIPOLE, -1).get_matrix());
-        op.d2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_DIPOLE, 0).get_matrix());
-        op.d2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_DIPOLE, 1).get_matrix());
+        op.d2 = construct(basis2, dipole_components2);
     }
 
     if (green_functions.quadrupole_quadrupole.nonZeros() > 0 ||
         green_functions.quadrupole_dipole.nonZeros() > 0) {
-        op.q1.push_back(
-            OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_QUADRUPOLE, 2).get_matrix());
-        op.q1.push_back(
-            -OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_QUADRUPOLE, 1).get_matrix());
-        op.q1.push_back(
-            OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_QUADRUPOLE, 0).get_matrix());
-        op.q1.push_back(
-            -OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_QUADRUPOLE, -1).get_matrix());
-        op.q1.push_back(
-            OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_QUADRUPOLE, -2).get_matrix());
-        op.q1.push_back(
-            OperatorAtom<Scalar>(basis1, OperatorType::ELECTRIC_QUADRUPOLE_ZERO, 0).get_matrix());
+        op.q1 = construct(basis1, quadrupole_components1);
     }
 
     if (green_functions.quadrupole_quadrupole.nonZeros() > 0 ||
         green_functions.dipole_quadrupole.nonZeros() > 0) {
-        op.q2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_QUADRUPOLE, -2).get_matrix());
-        op.q2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_QUADRUPOLE, -1).get_matrix());
-        op.q2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_QUADRUPOLE, 0).get_matrix());
-        op.q2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_QUADRUPOLE, 1).get_matrix());
-        op.q2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_QUADRUPOLE, 2).get_matrix());
-        op.q2.push_back(
-            OperatorAtom<Scalar>(basis2, OperatorType::ELECTRIC_QUADRUPOLE_ZERO, 0).get_matrix());
+        op.q2 = construct(basis2, quadrupole_components2);
     }
 
     return op;
@@ -315,6 +329,7 @@ SystemPair<Scalar>::SystemPair(std::shared_ptr<const basis_t> basis)
 template <typename Scalar>
 SystemPair<Scalar> &SystemPair<Scalar>::set_order(int value) {
     this->hamiltonian_requires_construction = true;
+    hamiltonian_factors.reset();
     if (value < 3 || value > 5) {
         throw std::invalid_argument("The order must be 3, 4, or 5.");
     }
@@ -330,10 +345,93 @@ SystemPair<Scalar> &SystemPair<Scalar>::set_distance(real_t value) {
 template <typename Scalar>
 SystemPair<Scalar> &SystemPair<Scalar>::set_distance_vector(const std::array<real_t, 3> &vector) {
     this->hamiltonian_requires_construction = true;
+    hamiltonian_factors.reset();
     distance_vector = vector;
     return *this;
 }
 
+template <typename Scalar>
+SystemPair<Scalar> &SystemPair<Scalar>::enable_interaction_caching(bool enable) {
+    this->hamiltonian_requires_construction = true;
+    cache_interaction = enable;
+    return *this;
+}
+
+template <typename Scalar>
+Eigen::VectorX<Scalar>
+SystemPair<Scalar>::apply_hamiltonian(const Eigen::VectorX<Scalar> &vector) const {
+    // Only the pending eigenvectors are applied to the basis, the Hamiltonian is not constructed
+    this->construct_eigenbasis();
+    auto basis = this->hamiltonian->get_basis();
+    if (static_cast<size_t>(vector.size()) != basis->get_number_of_states()) {
+        throw std::invalid_argument("The size of the vector must match the number of states.");
+    }
+
+    // The factors are expressed in the space of the kets, which is shared by all transformed
+    // bases, thus they only have to be constructed once
+    if (!hamiltonian_factors) {
+        auto basis1 = basis->get_basis1();
+        auto basis2 = basis->get_basis2();
+        auto green_functions = construct_green_functions<Scalar>(distance_vector, order);
+        auto op = construct_operator_matrices(green_functions, basis1, basis2);
+
+        auto factors = std::make_shared<HamiltonianFactors>();
+        factors->energies.resize(static_cast<Eigen::Index>(basis->get_number_of_kets()));
+        for (size_t ket_index = 0; ket_index < basis->get_number_of_kets(); ++ket_index) {
+            factors->energies[static_cast<Eigen::Index>(ket_index)] =
+                basis->get_kets()[ket_index]->get_energy();
+        }
+
+        // Contract the Green tensors with the operators of the second atom
+        auto add_terms = [&](const auto &matrices1, const auto &green_function_a,
+                             const auto &matrices2_a, const auto &green_function_b,
+                             const auto &matrices2_b) {
+            for (size_t row = 0; row < matrices1.size(); ++row) {
+                auto number_of_states2 = static_cast<Eigen::Index>(basis2->get_number_of_states());
+                Eigen::SparseMatrix<Scalar, Eigen::RowMajor> matrix2(number_of_states2,
+                                                                     number_of_states2);
+                for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it(
+                         green_function_a, static_cast<Eigen::Index>(row));
+                     it; ++it) {
+                    matrix2 += it.value() * matrices2_a[it.col()];
+                }
+                for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it(
+                         green_function_b, static_cast<Eigen::Index>(row));
+                     it; ++it) {
+                    matrix2 += it.value() * matrices2_b[it.col()];
+                }
+                if (matrix2.nonZeros() > 0) {
+                    matrix2.makeCompressed();
+                    factors->matrices1.push_back(matrices1[row]);
+                    factors->matrices1.back().makeCompressed();
+                    factors->matrices2.push_back(std::move(matrix2));
+                }
+            }
+        };
+        add_terms(op.d1, green_functions.dipole_dipole, op.d2, green_functions.dipole_quadrupole,
+                  op.q2);
+        add_terms(op.q1, green_functions.quadrupole_dipole, op.d2,
+                  green_functions.quadrupole_quadrupole, op.q2);
+
+        factors->tensor_products.reserve(factors->matrices1.size());
+        for (size_t i = 0; i < factors->matrices1.size(); ++i) {
+            factors->tensor_products.emplace_back(basis, factors->matrices1[i],
+                                                  factors->matrices2[i]);
+        }
+
+        hamiltonian_factors = std::move(factors);
+    }
+
+    // Apply the Hamiltonian in the space of the kets
+    const auto &coefficients = basis->get_coefficients();
+    Eigen::VectorX<Scalar> amplitudes = coefficients * vector;
+    Eigen::VectorX<Scalar> result = hamiltonian_factors->energies.cwiseProduct(amplitudes);
+    for (const auto &tensor_product : hamiltonian_factors->tensor_products) {
+        result += tensor_product.apply(basis, amplitudes);
+    }
+    return coefficients.adjoint() * result;
+}
+
 template <typename Scalar>
 void SystemPair<Scalar>::construct_hamiltonian() const {
     auto basis = this->hamiltonian->get_basis();
@@ -341,23 +439,50 @@ void SystemPair<Scalar>::construct_hamiltonian() const {
     auto basis2 = basis->get_basis2();
 
     auto green_functions = construct_green_functions<Scalar>(distance_vector, order);
-    auto op = construct_operator_matrices(green_functions, basis1, basis2);
+    auto op = cache_interaction ? OperatorMatrices<Scalar>{}
+                                : construct_operator_matrices(green_functions, basis1, basis2);
 
     // Construct the unperturbed Hamiltonian
     this->hamiltonian = std::make_unique<OperatorPair<Scalar>>(basis, OperatorType::ENERGY);
     this->hamiltonian_is_diagonal = true;
     bool sort_by_quantum_number_f = basis->has_quantum_number_f();
     bool sort_by_quantum_number_m = basis->has_quantum_number_m();
+    // The parity of a pair state is only well-defined for exchange-symmetrized states, where it
+    // denotes the symmetry under the exchange of the atoms
     bool sort_by_parity = basis->has_parity();
 
+    // The interaction is constructed in the space of the kets and transformed into the space of
+    // the states afterwards
+    auto number_of_kets = static_cast<int>(basis->get_number_of_kets());
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> interaction(number_of_kets, number_of_kets);
+
+    // Adds value * (operator1 ⊗ operator2) to the interaction. If the interaction is cached, the
+    // tensor product is taken from the basis, which calculates it only once for all distance
+    // vectors, as only the Green functions depend on the distance vector.
+    auto add_tensor_product = [&](Scalar value, const auto &matrices1, const auto &components1,
+                                  Eigen::Index index1, const auto &matrices2,
+                                  const auto &components2, Eigen::Index index2) {
+        if (cache_interaction) {
+            const auto &component1 = components1[index1];
+            const auto &component2 = components2[index2];
+            interaction += value * static_cast<Scalar>(component1.sign * component2.sign) *
+                *basis->get_matrix_elements_of_kets(component1.type, component2.type,
+                                                    component1.q, component2.q);
+        } else {
+            interaction += value *
+                utils::calculate_tensor_product(basis, basis, matrices1[index1],
+                                                matrices2[index2]);
+        }
+    };
+
     // Dipole-dipole interaction
     if (green_functions.dipole_dipole.nonZeros() > 0) {
         for (Eigen::Index row = 0; row < green_functions.dipole_dipole.rows(); ++row) {
             for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it(
                      green_functions.dipole_dipole, row);
                  it; ++it) {
-                this->hamiltonian->get_matrix() += it.value() *
-                    utils::calculate_tensor_product(basis, basis, op.d1[it.row()], op.d2[it.col()]);
+                add_tensor_product(it.value(), op.d1, dipole_components1, it.row(), op.d2,
+                                   dipole_components2, it.col());
                 if (it.row() != it.col()) {
                     sort_by_quantum_number_m = false;
                 }
@@ -373,8 +498,8 @@ void SystemPair<Scalar>::construct_hamiltonian() const {
             for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it(
                      green_functions.dipole_quadrupole, row);
                  it; ++it) {
-                this->hamiltonian->get_matrix() += it.value() *
-                    utils::calculate_tensor_product(basis, basis, op.d1[it.row()], op.q2[it.col()]);
+                add_tensor_product(it.value(), op.d1, dipole_components1, it.row(), op.q2,
+                                   quadrupole_components2, it.col());
                 if (it.row() != it.col() - 1) {
                     sort_by_quantum_number_m = false;
                 }
@@ -382,6 +507,7 @@ void SystemPair<Scalar>::construct_hamiltonian() const {
         }
         this->hamiltonian_is_diagonal = false;
         sort_by_quantum_number_f = false;
+        sort_by_parity = false; // odd in the distance vector, thus odd under the exchange
     }
 
     // Quadrupole-dipole interaction
@@ -390,8 +516,8 @@ void SystemPair<Scalar>::construct_hamiltonian() const {
             for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it(
                      green_functions.quadrupole_dipole, row);
                  it; ++it) {
-                this->hamiltonian->get_matrix() += it.value() *
-                    utils::calculate_tensor_product(basis, basis, op.q1[it.row()], op.d2[it.col()]);
+                add_tensor_product(it.value(), op.q1, quadrupole_components1, it.row(), op.d2,
+                                   dipole_components2, it.col());
                 if (it.row() - 1 != it.col()) {
                     sort_by_quantum_number_m = false;
                 }
@@ -399,6 +525,7 @@ void SystemPair<Scalar>::construct_hamiltonian() const {
         }
         this->hamiltonian_is_diagonal = false;
         sort_by_quantum_number_f = false;
+        sort_by_parity = false; // odd in the distance vector, thus odd under the exchange
     }
 
     // Quadrupole-quadrupole interaction
@@ -407,8 +534,8 @@ void SystemPair<Scalar>::construct_hamiltonian() const {
             for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it(
                      green_functions.quadrupole_quadrupole, row);
                  it; ++it) {
-                this->hamiltonian->get_matrix() += it.value() *
-                    utils::calculate_tensor_product(basis, basis, op.q1[it.row()], op.q2[it.col()]);
+                add_tensor_product(it.value(), op.q1, quadrupole_components1, it.row(), op.q2,
+                                   quadrupole_components2, it.col());
                 if (it.row() != it.col()) {
                     sort_by_quantum_number_m = false;
                 }
@@ -418,6 +545,11 @@ void SystemPair<Scalar>::construct_hamiltonian() const {
         sort_by_quantum_number_f = false;
     }
 
+    if (!this->hamiltonian_is_diagonal) {
+        this->hamiltonian->get_matrix() +=
+            basis->get_coefficients().adjoint() * interaction * basis->get_coefficients();
+    }
+
     // Store which labels can be used to block-diagonalize the Hamiltonian
     this->blockdiagonalizing_labels.clear();
     if (sort_by_quantum_number_f) {
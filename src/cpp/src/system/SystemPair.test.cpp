@@ -9,13 +9,19 @@
 #include "pairinteraction/diagonalizer/DiagonalizerFeast.hpp"
 #include "pairinteraction/diagonalizer/DiagonalizerLapackeEvd.hpp"
 #include "pairinteraction/diagonalizer/diagonalize.hpp"
+#include "pairinteraction/enums/Parity.hpp"
 #include "pairinteraction/ket/KetAtomCreator.hpp"
 #include "pairinteraction/system/SystemAtom.hpp"
 #include "pairinteraction/utils/Range.hpp"
 
 #include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <doctest/doctest.h>
 #include <fmt/ranges.h>
+#include <oneapi/tbb.h>
+#include <vector>
 
 namespace pairinteraction {
 
@@ -52,4 +58,172 @@ DOCTEST_TEST_CASE("construct a pair Hamiltonian") {
     DOCTEST_MESSAGE("Lowest energy: ", eigenvalues.minCoeff());
     DOCTEST_MESSAGE("Highest energy: ", eigenvalues.maxCoeff());
 }
+
+DOCTEST_TEST_CASE("construct a pair Hamiltonian in an exchange-symmetrized basis") {
+    auto &database = Database::get_global_instance();
+    auto diagonalizer = DiagonalizerEigen<double>();
+
+    auto basis = BasisAtomCreator<double>()
+                     .set_species("Rb")
+                     .restrict_quantum_number_n(60, 61)
+                     .restrict_quantum_number_l(0, 1)
+                     .restrict_quantum_number_m(-0.5, 0.5)
+                     .create(database);
+
+    SystemAtom<double> system(basis);
+    system.set_electric_field({0, 0, 1 * VOLT_PER_CM_IN_ATOMIC_UNITS});
+    system.diagonalize(diagonalizer);
+
+    auto basis_product = BasisPairCreator<double>().add(system).add(system).create();
+    auto basis_symmetrized = BasisPairCreator<double>()
+                                 .add(system)
+                                 .add(system)
+                                 .enable_exchange_symmetrization(true)
+                                 .create();
+    DOCTEST_CHECK(!basis_product->has_parity());
+    DOCTEST_CHECK(basis_symmetrized->has_parity());
+    DOCTEST_CHECK(basis_symmetrized->get_number_of_states() ==
+                  basis_product->get_number_of_states());
+
+    // The symmetrized basis describes the same space, thus the energies must agree
+    auto system_product = SystemPair<double>(basis_product);
+    system_product.set_distance(3 * UM_IN_ATOMIC_UNITS);
+    system_product.diagonalize(diagonalizer);
+
+    auto system_symmetrized = SystemPair<double>(basis_symmetrized);
+    system_symmetrized.set_distance(3 * UM_IN_ATOMIC_UNITS);
+
+    // The Hamiltonian must not couple the symmetric (even) and antisymmetric (odd) states
+    {
+        auto basis = system_symmetrized.get_basis();
+        const auto &matrix = system_symmetrized.get_matrix();
+        size_t number_of_even_states = 0;
+        for (size_t i = 0; i < basis->get_number_of_states(); ++i) {
+            number_of_even_states += basis->get_parity(i) == Parity::EVEN ? 1 : 0;
+        }
+        DOCTEST_CHECK(number_of_even_states > 0);
+        DOCTEST_CHECK(number_of_even_states < basis->get_number_of_states());
+
+        double norm_within_sectors = 0;
+        double norm_between_sectors = 0;
+        for (int row = 0; row < matrix.outerSize(); ++row) {
+            for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(matrix, row); it;
+                 ++it) {
+                if (it.row() == it.col()) {
+                    continue;
+                }
+                if (basis->get_parity(it.row()) == basis->get_parity(it.col())) {
+                    norm_within_sectors += it.value() * it.value();
+                } else {
+                    norm_between_sectors += it.value() * it.value();
+                }
+            }
+        }
+        DOCTEST_CHECK(norm_within_sectors > 0);
+        DOCTEST_CHECK(norm_between_sectors <= 1e-20 * norm_within_sectors);
+    }
+
+    system_symmetrized.diagonalize(diagonalizer);
+
+    Eigen::VectorXd eigenvalues_product = system_product.get_eigenvalues();
+    Eigen::VectorXd eigenvalues_symmetrized = system_symmetrized.get_eigenvalues();
+    std::sort(eigenvalues_product.begin(), eigenvalues_product.end());
+    std::sort(eigenvalues_symmetrized.begin(), eigenvalues_symmetrized.end());
+    DOCTEST_CHECK((eigenvalues_product - eigenvalues_symmetrized).norm() <
+                  1e-10 * eigenvalues_product.norm());
+
+    // The states of non-identical atoms can not be symmetrized
+    SystemAtom<double> system_other(basis);
+    system_other.set_electric_field({0, 0, 2 * VOLT_PER_CM_IN_ATOMIC_UNITS});
+    system_other.diagonalize(diagonalizer);
+    DOCTEST_CHECK_THROWS_AS(BasisPairCreator<double>()
+                                .add(system)
+                                .add(system_other)
+                                .enable_exchange_symmetrization(true)
+                                .create(),
+                            std::invalid_argument);
+}
+
+DOCTEST_TEST_CASE("apply a pair Hamiltonian without constructing it") {
+    auto &database = Database::get_global_instance();
+    auto diagonalizer = DiagonalizerEigen<double>();
+
+    auto basis = BasisAtomCreator<double>()
+                     .set_species("Rb")
+                     .restrict_quantum_number_n(60, 61)
+                     .restrict_quantum_number_l(0, 2)
+                     .create(database);
+
+    SystemAtom<double> system(basis);
+    system.set_electric_field({0, 0, 1 * VOLT_PER_CM_IN_ATOMIC_UNITS});
+    system.diagonalize(diagonalizer);
+
+    // Exposes whether the Hamiltonian has been constructed
+    class InspectableSystemPair : public SystemPair<double> {
+    public:
+        using SystemPair<double>::SystemPair;
+        bool is_hamiltonian_constructed() const { return !this->hamiltonian_requires_construction; }
+    };
+
+    auto basis_pair = BasisPairCreator<double>().add(system).add(system).create();
+    auto system_pair = InspectableSystemPair(basis_pair);
+    system_pair.set_order(5);
+    system_pair.set_distance_vector({1 * UM_IN_ATOMIC_UNITS, 0, 2 * UM_IN_ATOMIC_UNITS});
+
+    auto system_pair_ref = SystemPair<double>(basis_pair);
+    system_pair_ref.set_order(5);
+    system_pair_ref.set_distance_vector({1 * UM_IN_ATOMIC_UNITS, 0, 2 * UM_IN_ATOMIC_UNITS});
+
+    Eigen::VectorXd vector = Eigen::VectorXd::Random(basis_pair->get_number_of_states());
+    Eigen::VectorXd ref = system_pair_ref.get_matrix() * vector;
+    for (int repetition = 0; repetition < 2; ++repetition) {
+        DOCTEST_CHECK(ref.isApprox(system_pair.apply_hamiltonian(vector), 1e-11));
+    }
+    DOCTEST_CHECK(!system_pair.is_hamiltonian_constructed());
+}
+
+DOCTEST_TEST_CASE("construct pair Hamiltonians for several directions of the distance vector") {
+    auto &database = Database::get_global_instance();
+    auto diagonalizer = DiagonalizerEigen<double>();
+
+    auto basis = BasisAtomCreator<double>()
+                     .set_species("Rb")
+                     .restrict_quantum_number_n(60, 61)
+                     .restrict_quantum_number_l(0, 2)
+                     .create(database);
+
+    SystemAtom<double> system(basis);
+    system.set_electric_field({0, 0, 1 * VOLT_PER_CM_IN_ATOMIC_UNITS});
+    system.diagonalize(diagonalizer);
+
+    auto basis_pair = BasisPairCreator<double>().add(system).add(system).create();
+
+    std::vector<SystemPair<double>> system_pairs;
+    std::vector<SystemPair<double>> system_pairs_cached;
+    for (double angle : {0.3, 1.2, 2.0, 2.7}) {
+        std::array<double, 3> distance_vector{5 * std::sin(angle) * UM_IN_ATOMIC_UNITS, 0,
+                                              5 * std::cos(angle) * UM_IN_ATOMIC_UNITS};
+
+        auto system_pair = SystemPair<double>(basis_pair);
+        system_pair.set_order(5);
+        system_pair.set_distance_vector(distance_vector);
+        system_pairs.push_back(std::move(system_pair));
+
+        auto system_pair_cached = SystemPair<double>(basis_pair);
+        system_pair_cached.set_order(5);
+        system_pair_cached.set_distance_vector(distance_vector);
+        system_pair_cached.enable_interaction_caching(true);
+        system_pairs_cached.push_back(std::move(system_pair_cached));
+    }
+
+    // The cached Hamiltonians are constructed concurrently, so that the cache of the basis is
+    // accessed by several threads at once
+    oneapi::tbb::parallel_for(size_t{0}, system_pairs_cached.size(),
+                              [&](size_t idx) { system_pairs_cached[idx].get_matrix(); });
+
+    for (size_t idx = 0; idx < system_pairs.size(); ++idx) {
+        DOCTEST_CHECK(system_pairs_cached[idx].get_matrix().isApprox(
+            system_pairs[idx].get_matrix(), 1e-11));
+    }
+}
 } // namespace pairinteraction
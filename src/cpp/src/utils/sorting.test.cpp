@@ -0,0 +1,30 @@
+#include "pairinteraction/utils/sorting.hpp"
+
+#include <doctest/doctest.h>
+#include <numeric>
+#include <random>
+
+namespace pairinteraction {
+DOCTEST_TEST_CASE("stable sort of values by integer keys") {
+    std::mt19937_64 generator(42);
+
+    for (size_t number_of_values : {size_t{100}, size_t{100000}}) {
+        std::vector<std::uint64_t> keys(number_of_values);
+        for (auto &key : keys) {
+            key = generator() & ((std::uint64_t{1} << 20) - 1);
+        }
+        std::vector<int> values(number_of_values);
+        std::iota(values.begin(), values.end(), 0);
+
+        // Sort the values by the keys using std::stable_sort as a reference
+        std::vector<int> values_reference = values;
+        std::stable_sort(values_reference.begin(), values_reference.end(),
+                         [&](int a, int b) { return keys[a] < keys[b]; });
+
+        sorting::stable_sort_by_key(keys, values.data(), 20);
+
+        DOCTEST_CHECK(values == values_reference);
+        DOCTEST_CHECK(std::is_sorted(keys.begin(), keys.end()));
+    }
+}
+} // namespace pairinteraction
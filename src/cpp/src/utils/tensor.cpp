@@ -9,6 +9,8 @@
 #include <limits>
 #include <memory>
 #include <oneapi/tbb.h>
+#include <stdexcept>
+#include <vector>
 
 namespace pairinteraction::utils {
 
@@ -99,6 +101,168 @@ calculate_tensor_product(const std::shared_ptr<const BasisPair<Scalar>> &basis_i
     return matrix;
 }
 
+template <typename Scalar>
+TensorProductOperator<Scalar>::TensorProductOperator(
+    std::shared_ptr<const BasisPair<Scalar>> basis_initial,
+    const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix1,
+    const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix2)
+    : basis_initial(std::move(basis_initial)), matrix1(matrix1), matrix2(matrix2) {
+    if (!matrix1.isCompressed() || !matrix2.isCompressed()) {
+        throw std::invalid_argument("The factors of the tensor product must be compressed.");
+    }
+}
+
+template <typename Scalar>
+template <typename Function>
+void TensorProductOperator<Scalar>::for_each_entry_in_row(Eigen::Index row1, Eigen::Index row2,
+                                                          Function &&function) const {
+    using real_t = typename traits::NumTraits<Scalar>::real_t;
+    constexpr real_t numerical_precision = 100 * std::numeric_limits<real_t>::epsilon();
+
+    const int *begin_col2 = matrix2.innerIndexPtr() + matrix2.outerIndexPtr()[row2];
+    const int *end_col2 = matrix2.innerIndexPtr() + matrix2.outerIndexPtr()[row2 + 1];
+
+    for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator it1(matrix1, row1);
+         it1; ++it1) {
+        Eigen::Index col1 = it1.col();
+
+        // Only loop over the columns of the second matrix that are energetically allowed
+        const auto &range_col2 = basis_initial->get_index_range(col1);
+        for (const int *col2 =
+                 std::lower_bound(begin_col2, end_col2, static_cast<int>(range_col2.min()));
+             col2 != end_col2 && *col2 < static_cast<int>(range_col2.max()); ++col2) {
+            int ket_index = basis_initial->get_ket_index_from_tuple(col1, *col2);
+            if (ket_index < 0) {
+                continue;
+            }
+            Scalar value = it1.value() * matrix2.valuePtr()[col2 - matrix2.innerIndexPtr()];
+            if (std::abs(value) > numerical_precision) {
+                function(ket_index, value);
+            }
+        }
+    }
+}
+
+template <typename Scalar>
+Eigen::VectorX<Scalar>
+TensorProductOperator<Scalar>::apply(const std::shared_ptr<const BasisPair<Scalar>> &basis_final,
+                                     const Eigen::VectorX<Scalar> &vector) const {
+    if (static_cast<size_t>(vector.size()) != basis_initial->get_number_of_kets()) {
+        throw std::invalid_argument("The size of the vector must match the number of kets.");
+    }
+
+    Eigen::VectorX<Scalar> result = Eigen::VectorX<Scalar>::Zero(basis_final->get_number_of_kets());
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<Eigen::Index>(0, matrix1.outerSize()), [&](const auto &range) {
+            for (Eigen::Index row1 = range.begin(); row1 != range.end(); ++row1) {
+                const auto &range_row2 = basis_final->get_index_range(row1);
+                for (auto row2 = static_cast<Eigen::Index>(range_row2.min());
+                     row2 < static_cast<Eigen::Index>(range_row2.max()); ++row2) {
+                    int row = basis_final->get_ket_index_from_tuple(row1, row2);
+                    if (row < 0) {
+                        continue;
+                    }
+                    Scalar sum = 0;
+                    for_each_entry_in_row(row1, row2, [&](int col, Scalar value) {
+                        sum += value * vector[col];
+                    });
+                    result[row] = sum;
+                }
+            }
+        });
+    return result;
+}
+
+template <typename Scalar>
+Eigen::SparseMatrix<Scalar, Eigen::RowMajor>
+TensorProductOperator<Scalar>::apply(
+    const std::shared_ptr<const BasisPair<Scalar>> &basis_final,
+    const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix) const {
+    return apply_to_rows(
+        static_cast<Eigen::Index>(basis_final->get_number_of_kets()),
+        [&](Eigen::Index row1, auto &&function) {
+            const auto &range_row2 = basis_final->get_index_range(row1);
+            for (auto row2 = static_cast<Eigen::Index>(range_row2.min());
+                 row2 < static_cast<Eigen::Index>(range_row2.max()); ++row2) {
+                int row = basis_final->get_ket_index_from_tuple(row1, row2);
+                if (row >= 0) {
+                    function(row2, row);
+                }
+            }
+        },
+        matrix);
+}
+
+template <typename Scalar>
+Eigen::SparseMatrix<Scalar, Eigen::RowMajor> TensorProductOperator<Scalar>::apply(
+    const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix) const {
+    return apply_to_rows(
+        matrix1.rows() * matrix2.rows(),
+        [&](Eigen::Index row1, auto &&function) {
+            for (Eigen::Index row2 = 0; row2 < matrix2.rows(); ++row2) {
+                function(row2, row1 * matrix2.rows() + row2);
+            }
+        },
+        matrix);
+}
+
+template <typename Scalar>
+template <typename ForEachRow>
+Eigen::SparseMatrix<Scalar, Eigen::RowMajor> TensorProductOperator<Scalar>::apply_to_rows(
+    Eigen::Index number_of_rows, ForEachRow &&for_each_row,
+    const Eigen::SparseMatrix<Scalar, Eigen::RowMajor> &matrix) const {
+    if (static_cast<size_t>(matrix.rows()) != basis_initial->get_number_of_kets()) {
+        throw std::invalid_argument("The number of rows must match the number of kets.");
+    }
+
+    // Each thread accumulates a row of the result in a dense buffer and remembers which columns
+    // were touched, so that the buffer can be cleared cheaply
+    struct Accumulator {
+        std::vector<Scalar> values;
+        std::vector<char> is_touched;
+        std::vector<int> touched;
+    };
+    oneapi::tbb::enumerable_thread_specific<Accumulator> accumulators([&] {
+        return Accumulator{std::vector<Scalar>(matrix.cols(), 0),
+                           std::vector<char>(matrix.cols(), 0), {}};
+    });
+
+    oneapi::tbb::concurrent_vector<Eigen::Triplet<Scalar>> triplets;
+
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<Eigen::Index>(0, matrix1.outerSize()), [&](const auto &range) {
+            auto &accumulator = accumulators.local();
+            std::vector<Eigen::Triplet<Scalar>> local_triplets;
+            for (Eigen::Index row1 = range.begin(); row1 != range.end(); ++row1) {
+                for_each_row(row1, [&](Eigen::Index row2, Eigen::Index row) {
+                    for_each_entry_in_row(row1, row2, [&](int ket_index, Scalar value) {
+                        for (typename Eigen::SparseMatrix<Scalar, Eigen::RowMajor>::InnerIterator
+                                 it(matrix, ket_index);
+                             it; ++it) {
+                            if (accumulator.is_touched[it.col()] == 0) {
+                                accumulator.is_touched[it.col()] = 1;
+                                accumulator.touched.push_back(static_cast<int>(it.col()));
+                            }
+                            accumulator.values[it.col()] += value * it.value();
+                        }
+                    });
+                    for (int col : accumulator.touched) {
+                        local_triplets.emplace_back(row, col, accumulator.values[col]);
+                        accumulator.values[col] = 0;
+                        accumulator.is_touched[col] = 0;
+                    }
+                    accumulator.touched.clear();
+                });
+            }
+            triplets.grow_by(local_triplets.begin(), local_triplets.end());
+        });
+
+    Eigen::SparseMatrix<Scalar, Eigen::RowMajor> result(number_of_rows, matrix.cols());
+    result.setFromTriplets(triplets.begin(), triplets.end());
+    result.makeCompressed();
+    return result;
+}
+
 // Explicit instantiations
 template Eigen::SparseMatrix<double, Eigen::RowMajor>
 calculate_tensor_product(const std::shared_ptr<const BasisPair<double>> &,
@@ -110,5 +274,7 @@ calculate_tensor_product(const std::shared_ptr<const BasisPair<std::complex<doub
                          const std::shared_ptr<const BasisPair<std::complex<double>>> &,
                          const Eigen::SparseMatrix<std::complex<double>, Eigen::RowMajor> &,
                          const Eigen::SparseMatrix<std::complex<double>, Eigen::RowMajor> &);
+template class TensorProductOperator<double>;
+template class TensorProductOperator<std::complex<double>>;
 
 } // namespace pairinteraction::utils
@@ -31,4 +31,24 @@ DOCTEST_TEST_CASE("construction of wigner D matrix") {
     DOCTEST_CHECK(std::abs(wigner_complex_entry - wigner_complex_entry_reference) <=
                   numerical_precision);
 }
+
+DOCTEST_TEST_CASE("construction of a block of the wigner D matrix") {
+    constexpr double PI = 3.141592653589793238462643383279502884;
+    constexpr double numerical_precision = 100 * std::numeric_limits<double>::epsilon();
+
+    for (double f : {0.0, 0.5, 2.0, 3.5}) {
+        auto block = wigner::wigner_uppercase_d_matrix_block<std::complex<double>>(
+            f, 0.3 * PI, 0.7 * PI, -0.2 * PI);
+        auto dim = static_cast<size_t>(2 * f + 1);
+        DOCTEST_REQUIRE(block.size() == dim * dim);
+        for (size_t i = 0; i < dim; ++i) {
+            for (size_t j = 0; j < dim; ++j) {
+                auto reference = wigner::wigner_uppercase_d_matrix<std::complex<double>>(
+                    f, static_cast<double>(i) - f, static_cast<double>(j) - f, 0.3 * PI, 0.7 * PI,
+                    -0.2 * PI);
+                DOCTEST_CHECK(std::abs(block[j * dim + i] - reference) <= numerical_precision);
+            }
+        }
+    }
+}
 } // namespace pairinteraction
@@ -1,4 +1,5 @@
 from abc import ABC
+from collections.abc import Sequence
 from functools import cached_property
 from typing import TYPE_CHECKING, Any, ClassVar, Generic, TypeVar, Union
 
@@ -65,6 +66,11 @@ class BasisBase(ABC, Generic[KetType]):
     def coefficients(self) -> "csr_matrix":
         return self._cpp.get_coefficients()
 
+    def get_states(self: "Self", state_indices: Sequence[int]) -> "Self":
+        """Return a basis that consists of the states with the given indices, obtained in a single call."""
+        cpp_basis = self._cpp.get_states([int(index) for index in state_indices])
+        return type(self)._from_cpp_object(cpp_basis)
+
     def get_corresponding_state(self: "Self", ket_or_index: Union[KetType, int]) -> "Self":
         if isinstance(ket_or_index, (int, np.integer)):
             cpp_basis = self._cpp.get_corresponding_state(ket_or_index)
@@ -1,3 +1,4 @@
+from collections.abc import Sequence
 from typing import TYPE_CHECKING, Any, ClassVar, Optional, Union, overload
 
 import numpy as np
@@ -137,7 +138,12 @@ class BasisAtom(BasisBase[KetAtom]):
     @overload
     def get_amplitudes(self, ket_or_basis: "Self") -> "csr_matrix": ...
 
-    def get_amplitudes(self, ket_or_basis: Union[KetAtom, "Self"]):
+    @overload
+    def get_amplitudes(self, ket_or_basis: Sequence[KetAtom]) -> "csr_matrix": ...
+
+    def get_amplitudes(self, ket_or_basis: Union[KetAtom, "Self", Sequence[KetAtom]]):
+        if isinstance(ket_or_basis, Sequence):
+            return self._cpp.get_amplitudes([ket._cpp for ket in ket_or_basis])  # type: ignore [reportPrivateUsage]
         return self._cpp.get_amplitudes(ket_or_basis._cpp)
 
     @overload
@@ -146,7 +152,12 @@ class BasisAtom(BasisBase[KetAtom]):
     @overload
     def get_overlaps(self, ket_or_basis: "Self") -> "csr_matrix": ...
 
-    def get_overlaps(self, ket_or_basis: Union[KetAtom, "Self"]):
+    @overload
+    def get_overlaps(self, ket_or_basis: Sequence[KetAtom]) -> "csr_matrix": ...
+
+    def get_overlaps(self, ket_or_basis: Union[KetAtom, "Self", Sequence[KetAtom]]):
+        if isinstance(ket_or_basis, Sequence):
+            return self._cpp.get_overlaps([ket._cpp for ket in ket_or_basis])  # type: ignore [reportPrivateUsage]
         return self._cpp.get_overlaps(ket_or_basis._cpp)
 
     @overload
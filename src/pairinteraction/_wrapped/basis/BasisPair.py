@@ -41,6 +41,12 @@ class BasisPair(BasisBase[KetPairType]):
     not be square but (n x d),
     where n is the number of all involved kets (typically basis1.number_of_kets * basis2.number_of_kets)
     and d is the number of basis states (after applying the restrictions).
+    If both atoms conserve the magnetic quantum number m, the kets are grouped by the total magnetic quantum number m
+    in ascending order, and within each group they keep the order of the product states. To find a ket in the basis,
+    look it up, e.g. via `get_amplitudes` or `get_overlaps`, instead of relying on its position.
+    For identical atoms, the basis can instead consist of states that are symmetric or antisymmetric under the exchange
+    of the atoms. The exchange symmetry of these states is stored as their parity label, i.e. symmetric states have
+    even and antisymmetric states odd parity, and the parity label does not refer to the spatial parity in this case.
 
     Examples:
         >>> import pairinteraction.real as pi
@@ -54,7 +60,7 @@ class BasisPair(BasisBase[KetPairType]):
         ...     energy_unit="GHz",
         ... )
         >>> print(pair_basis)
-        BasisPair(|Rb:59,S_1/2,-1/2; Rb:61,S_1/2,-1/2⟩ ... |Rb:58,F_7/2,7/2; Rb:59,S_1/2,1/2⟩)
+        BasisPair(|Rb:59,S_1/2,-1/2; Rb:58,F_7/2,-7/2⟩ ... |Rb:58,F_7/2,7/2; Rb:59,S_1/2,1/2⟩)
 
     """
 
@@ -66,6 +72,7 @@ class BasisPair(BasisBase[KetPairType]):
         systems: Collection["SystemAtom"],
         m: Optional[tuple[float, float]] = None,
         product_of_parities: Optional[Parity] = None,
+        exchange_symmetrized: bool = False,
         energy: Union[tuple[float, float], tuple["PlainQuantity[float]", "PlainQuantity[float]"], None] = None,
         energy_unit: Optional[str] = None,
     ) -> None:
@@ -78,6 +85,10 @@ class BasisPair(BasisBase[KetPairType]):
                 Default None, i.e. no restriction.
             product_of_parities: The product parity of the states to consider.
                 Default None, i.e. add all available states.
+            exchange_symmetrized: Whether to use pair states that are symmetric or antisymmetric under the exchange
+                of the two atoms, which requires both systems to describe identical atoms. The symmetric states have
+                even and the antisymmetric states odd parity, so that the Hamiltonian can be block-diagonalized by
+                the parity. Default False, i.e. use product states.
             energy: tuple of (min, max) value for the pair energy. Default None, i.e. add all available states.
             energy_unit: In which unit the energy values are given, e.g. "GHz".
                 Default None, i.e. energy is provided as pint object.
@@ -90,6 +101,8 @@ class BasisPair(BasisBase[KetPairType]):
             creator.restrict_quantum_number_m(*m)
         if product_of_parities is not None:
             creator.restrict_product_of_parities(get_cpp_parity(product_of_parities))
+        if exchange_symmetrized:
+            creator.enable_exchange_symmetrization(True)
         if energy is not None:
             min_energy_au = QuantityScalar.from_pint_or_unit(energy[0], energy_unit, "ENERGY").to_base_unit()
             max_energy_au = QuantityScalar.from_pint_or_unit(energy[1], energy_unit, "ENERGY").to_base_unit()
@@ -102,13 +115,11 @@ class BasisPair(BasisBase[KetPairType]):
     @overload
     def get_amplitudes(self, ket_or_basis: BasisPairLike) -> "csr_matrix": ...
 
-    def get_amplitudes(self, ket_or_basis: Union["KetPairLike", BasisPairLike]):
-        ket_or_basis_cpp: list[Any]
-        if not isinstance(ket_or_basis, Iterable):
-            ket_or_basis_cpp = [ket_or_basis._cpp]
-        else:
-            ket_or_basis_cpp = [obj._cpp for obj in ket_or_basis]
-        return self._cpp.get_amplitudes(*ket_or_basis_cpp)
+    @overload
+    def get_amplitudes(self, ket_or_basis: Sequence["KetPairLike"]) -> "csr_matrix": ...
+
+    def get_amplitudes(self, ket_or_basis: Union["KetPairLike", BasisPairLike, Sequence["KetPairLike"]]):
+        return self._cpp.get_amplitudes(*self._get_cpp_arguments(ket_or_basis))
 
     @overload
     def get_overlaps(self, ket_or_basis: "KetPairLike") -> "NDArray[Any]": ...
@@ -116,13 +127,28 @@ class BasisPair(BasisBase[KetPairType]):
     @overload
     def get_overlaps(self, ket_or_basis: BasisPairLike) -> "csr_matrix": ...
 
-    def get_overlaps(self, ket_or_basis: Union["KetPairLike", BasisPairLike]):
-        ket_or_basis_cpp: list[Any]
+    @overload
+    def get_overlaps(self, ket_or_basis: Sequence["KetPairLike"]) -> "csr_matrix": ...
+
+    def get_overlaps(self, ket_or_basis: Union["KetPairLike", BasisPairLike, Sequence["KetPairLike"]]):
+        return self._cpp.get_overlaps(*self._get_cpp_arguments(ket_or_basis))
+
+    @staticmethod
+    def _get_cpp_arguments(ket_or_basis: Union["KetPairLike", BasisPairLike, Sequence["KetPairLike"]]) -> list[Any]:
+        """Convert a pair ket, a pair basis, or a sequence of pair kets into the arguments of the C++ methods.
+
+        A sequence of pair kets is passed as a whole, so that the result for all pair kets is calculated in a single
+        call with one row per pair ket.
+        """
         if not isinstance(ket_or_basis, Iterable):
-            ket_or_basis_cpp = [ket_or_basis._cpp]
-        else:
-            ket_or_basis_cpp = [obj._cpp for obj in ket_or_basis]
-        return self._cpp.get_overlaps(*ket_or_basis_cpp)
+            return [ket_or_basis._cpp]
+        objs = list(ket_or_basis)
+        if all(isinstance(obj, KetPair) for obj in objs):
+            return [[obj._cpp for obj in objs]]  # type: ignore [reportPrivateUsage]
+        if all(isinstance(obj, Iterable) for obj in objs):
+            kets = [tuple(obj) for obj in objs]
+            return [[ket[0]._cpp for ket in kets], [ket[1]._cpp for ket in kets]]  # type: ignore [reportPrivateUsage]
+        return [obj._cpp for obj in objs]  # type: ignore [reportPrivateUsage]
 
     @overload
     def get_matrix_elements(
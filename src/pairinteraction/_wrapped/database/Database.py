@@ -2,10 +2,13 @@ import logging
 from typing import TYPE_CHECKING, ClassVar, Optional, Union
 
 from pairinteraction import _backend
+from pairinteraction._wrapped.cpp_types import get_cpp_float_type
 
 if TYPE_CHECKING:
     import os
 
+    from pairinteraction._wrapped.cpp_types import FloatType
+
 
 logger = logging.getLogger(__name__)
 
@@ -30,6 +33,7 @@ class Database:
         download_missing: bool = False,
         use_cache: bool = True,
         database_dir: Union[str, "os.PathLike[str]"] = "",
+        use_persistent_store: bool = False,
     ) -> None:
         """Create a new database instance with the given parameters.
 
@@ -38,12 +42,45 @@ class Database:
             use_cache: Whether to load the Wigner 3j symbols table into memory. Default True.
             database_dir: The directory where the databases are stored.
                 Default "", i.e. use the default directory (the user's cache directory).
+            use_persistent_store: Whether to import the tables once into a DuckDB database file in the
+                database directory, which is sorted and indexed and can be opened read-only by many processes
+                at the same time. Default False.
 
         """
-        self._cpp = CPPDatabase(download_missing, use_cache, database_dir)
+        self._cpp = CPPDatabase(download_missing, use_cache, database_dir, use_persistent_store)
         self.download_missing = download_missing
         self.use_cache = use_cache
         self.database_dir = database_dir
+        self.use_persistent_store = use_persistent_store
+
+    def set_use_native_index(self, use_native_index: bool, float_type: "FloatType" = "float64") -> None:
+        """Set whether to assemble matrix elements from a native in-memory index of the database tables.
+
+        The index is built once per table of matrix elements. Afterwards, operators are assembled by direct,
+        parallel lookups instead of join queries, which is faster for large bases but requires that the whole table
+        fits into memory.
+
+        Args:
+            use_native_index: Whether to use the native in-memory index. Default is False.
+            float_type: The floating point precision in which the reduced matrix elements are stored in the index.
+                With "float32", the memory usage is reduced and each matrix element has a relative error of at most
+                2^-24 (about 6e-8). Default "float64", which gives exact results.
+
+        """
+        self._cpp.set_use_native_index(use_native_index, get_cpp_float_type(float_type))
+
+    def set_prefetch_operators(self, prefetch_operators: bool) -> None:
+        """Set whether to compute the operators of a basis in the background as soon as the basis is created.
+
+        If enabled, the electric dipole, electric quadrupole, magnetic dipole, and the q0 operators of every basis that
+        is obtained from the database are computed on background threads. Requesting such an operator afterwards
+        (e.g. when creating a system) only blocks until the background computation has finished.
+
+        Args:
+            prefetch_operators: Whether to prefetch the operators. Default is False.
+
+        """
+        self._cpp.set_prefetch_operators(prefetch_operators)
 
     @classmethod
     def get_global_database(cls) -> "Database":
@@ -56,17 +93,19 @@ class Database:
         download_missing: bool = False,
         use_cache: bool = True,
         database_dir: Union[str, "os.PathLike[str]"] = "",
+        use_persistent_store: bool = False,
     ) -> None:
         """Initialize the global database with the given parameters.
 
         The arguments are the same as for the constructor of this class.
         """
         if cls._global_database is None:
-            cls._global_database = cls(download_missing, use_cache, database_dir)
+            cls._global_database = cls(download_missing, use_cache, database_dir, use_persistent_store)
         elif (
             cls._global_database.download_missing == download_missing
             and cls._global_database.use_cache == use_cache
             and cls._global_database.database_dir == database_dir
+            and cls._global_database.use_persistent_store == use_persistent_store
         ):
             pass  # already initialized with the same parameters
         else:
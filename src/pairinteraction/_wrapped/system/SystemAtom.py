@@ -84,6 +84,9 @@ class SystemAtom(SystemBase[BasisType]):
         self._cpp.enable_diamagnetism(enable)
         return self
 
+    def get_eigenbasis_overlaps(self: "Self", ket: "KetAtom") -> "NDArray[Any]":
+        return self._cpp.get_eigenbasis_overlaps(ket._cpp)
+
     @overload
     def get_corresponding_energy(self: "Self", ket: "KetAtom") -> "PlainQuantity[float]": ...
 
@@ -91,7 +94,7 @@ class SystemAtom(SystemBase[BasisType]):
     def get_corresponding_energy(self: "Self", ket: "KetAtom", unit: str) -> float: ...
 
     def get_corresponding_energy(self: "Self", ket: "KetAtom", unit: Optional[str] = None):
-        overlaps = self.get_eigenbasis().get_overlaps(ket)
+        overlaps = self.get_eigenbasis_overlaps(ket)
         idx = np.argmax(overlaps)
         if overlaps[idx] <= 0.5:
             logger.warning(
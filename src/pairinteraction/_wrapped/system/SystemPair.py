@@ -6,7 +6,7 @@ import numpy as np
 from pairinteraction import _backend
 from pairinteraction._wrapped.basis.BasisPair import BasisPairComplex, BasisPairReal
 from pairinteraction._wrapped.system.System import SystemBase
-from pairinteraction.units import QuantityScalar
+from pairinteraction.units import QuantityArray, QuantityScalar
 
 if TYPE_CHECKING:
     from numpy.typing import NDArray
@@ -38,7 +38,7 @@ class SystemPair(SystemBase[BasisType]):
         ... )
         >>> pair_system = pi.SystemPair(pair_basis).set_distance(5, unit="micrometer").set_order(3)
         >>> print(pair_system)
-        SystemPair(BasisPair(|Rb:59,S_1/2,-1/2; Rb:61,S_1/2,-1/2⟩ ... |Rb:58,F_7/2,7/2; Rb:59,S_1/2,1/2⟩), is_diagonal=False)
+        SystemPair(BasisPair(|Rb:59,S_1/2,-1/2; Rb:58,F_7/2,-7/2⟩ ... |Rb:58,F_7/2,7/2; Rb:59,S_1/2,1/2⟩), is_diagonal=False)
         >>> pair_system = pair_system.diagonalize()
         >>> eigenvalues = pair_system.get_eigenvalues(unit="GHz")
 
@@ -76,6 +76,22 @@ class SystemPair(SystemBase[BasisType]):
         self._distance_vector_au = distance_au
         return self
 
+    def enable_interaction_caching(self: "Self", enable: bool = True) -> "Self":
+        """Cache the angle-independent interaction matrices in the basis of the system.
+
+        The interaction is a sum of tensor products of single-atom multipole operators, weighted by the entries of the
+        Green tensor, which contain all dependence on the distance vector. If caching is enabled, the tensor products
+        are stored in the basis and shared by all systems that use the same basis. Scanning the direction or the
+        distance between the atoms then only requires a weighted sum of the cached matrices per system, at the cost of
+        keeping the matrices in memory.
+
+        Args:
+            enable: Whether to cache the interaction matrices. Default True.
+
+        """
+        self._cpp.enable_interaction_caching(enable)
+        return self
+
     @overload
     def get_distance_vector(self) -> list["PlainQuantity[float]"]: ...
 
@@ -96,6 +112,30 @@ class SystemPair(SystemBase[BasisType]):
         distance = np.linalg.norm(self._distance_vector_au)
         return QuantityScalar.from_base_unit(float(distance), "DISTANCE").to_pint_or_unit(unit)
 
+    @overload
+    def apply_hamiltonian(self, vector: "NDArray[Any]") -> "PlainQuantity[NDArray[Any]]": ...
+
+    @overload
+    def apply_hamiltonian(self, vector: "NDArray[Any]", unit: str) -> "NDArray[Any]": ...
+
+    def apply_hamiltonian(self, vector: "NDArray[Any]", unit: Optional[str] = None):  # type: ignore
+        """Apply the Hamiltonian to a vector without constructing the Hamiltonian.
+
+        The Hamiltonian is applied using the single-atom operators, so that its memory footprint does not grow with
+        the number of non-zero entries of the pair Hamiltonian. This allows to use iterative eigensolvers or time
+        propagation, e.g. via scipy.sparse.linalg.LinearOperator, for bases whose Hamiltonian does not fit into memory.
+
+        Args:
+            vector: The amplitudes of the states of the basis of the system.
+            unit: The unit to which to convert the result. Default None will return a pint quantity.
+
+        Returns:
+            The Hamiltonian applied to the vector.
+
+        """
+        result_au = self._cpp.apply_hamiltonian(vector)
+        return QuantityArray.from_base_unit(result_au, "ENERGY").to_pint_or_unit(unit)
+
 
 class SystemPairReal(SystemPair[BasisPairReal]):
     _cpp: _backend.SystemPairReal  # type: ignore [reportIncompatibleVariableOverride]
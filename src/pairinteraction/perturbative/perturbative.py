@@ -553,9 +553,10 @@ def _get_model_inds(ket_tuple_list: Collection["KetPairLike"], system_pair: "Sys
         List of indices corresponding to the states that span up the model space.
 
     """
+    ket_tuple_list = list(ket_tuple_list)
+    overlaps = system_pair.basis.get_overlaps(ket_tuple_list).toarray()
     model_inds = []
-    for kets in ket_tuple_list:
-        overlap = system_pair.basis.get_overlaps(kets)
+    for kets, overlap in zip(ket_tuple_list, overlaps):
         index = np.argmax(overlap)
         if overlap[index] == 0:
             raise ValueError(f"The pairstate {kets} is not part of the basis of the pair system.")
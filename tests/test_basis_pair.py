@@ -0,0 +1,39 @@
+"""Test the order of the kets of a pair basis."""
+
+import numpy as np
+
+import pairinteraction.real as pi
+
+
+def test_kets_sorted_by_quantum_number_m() -> None:
+    """Test that the kets of a pair basis are grouped by the total quantum number m."""
+    basis = pi.BasisAtom("Rb", n=(59, 61), l=(0, 1))
+    system = pi.SystemAtom(basis).set_magnetic_field([0, 0, 1], unit="G").diagonalize()
+
+    basis_pair = pi.BasisPair([system, system])
+    kets = basis_pair.kets
+    quantum_numbers_m = np.array([ket.m for ket in kets])
+
+    # The kets are sorted by m in ascending order
+    assert np.all(np.diff(quantum_numbers_m) >= 0)
+
+    # Within a group of kets with the same m, the kets keep the order of the product states, which is the order of
+    # the kets in a basis that is restricted to this m
+    labels = []
+    for m in np.unique(quantum_numbers_m):
+        basis_pair_of_m = pi.BasisPair([system, system], m=(m, m))
+        labels += [str(ket) for ket in basis_pair_of_m.kets]
+    assert [str(ket) for ket in kets] == labels
+
+
+def test_kets_outlive_basis() -> None:
+    """Test that the kets of a pair basis remain valid after the basis has been deleted."""
+    basis = pi.BasisAtom("Rb", n=(59, 61), l=(0, 1))
+    system = pi.SystemAtom(basis).set_magnetic_field([0, 0, 1], unit="G").diagonalize()
+
+    basis_pair = pi.BasisPair([system, system])
+    labels = [str(ket) for ket in basis_pair.kets]
+    kets = basis_pair.kets
+    del basis_pair
+
+    assert [str(ket) for ket in kets] == labels
@@ -4,6 +4,7 @@ import os
 import sys
 from dataclasses import dataclass
 from pathlib import Path
+from typing import Optional
 
 import duckdb
 
@@ -62,26 +63,68 @@ def delete_old_parquet_and_csv_files(path_target: Path, parquet_and_csv_files: d
                 )
 
 
+# Columns by which the rows of the tables are sorted. The first matching entry is used. Sorting the rows clusters
+# them so that the min/max statistics of the row groups allow the readers to skip row groups that do not match the
+# range filters on the ids (matrix elements) or on the quantum numbers (states).
+SORT_COLUMNS: list[list[str]] = [
+    ["id_initial", "id_final"],
+    ["n", "exp_l", "id"],
+    ["kappa", "q", "f_initial", "f_final"],
+]
+
+# Number of rows per row group. Small row groups allow for a fine-grained skipping of rows, large row groups
+# compress better. The states tables are filtered most selectively, thus they get the smallest row groups.
+DEFAULT_ROW_GROUP_SIZES: dict[str, int] = {"states": 16_384, "matrix_elements": 65_536}
+FALLBACK_ROW_GROUP_SIZE = 100_000
+
+
+def get_sort_columns(connection: duckdb.DuckDBPyConnection, table_name: str) -> list[str]:
+    """Get the columns by which the given table should be sorted."""
+    columns = {row[0] for row in connection.execute(f"DESCRIBE {table_name}").fetchall()}
+    return next((candidate for candidate in SORT_COLUMNS if columns.issuperset(candidate)), [])
+
+
+def get_row_group_size(table_name: str, row_group_size: Optional[int]) -> int:
+    """Get the number of rows per row group for the given table."""
+    if row_group_size is not None:
+        return row_group_size
+    return next(
+        (size for kind, size in DEFAULT_ROW_GROUP_SIZES.items() if kind in table_name), FALLBACK_ROW_GROUP_SIZE
+    )
+
+
 def write_parquet_files(
     connection: duckdb.DuckDBPyConnection,
     parquet_and_csv_files: dict[str, TableFile],
     path_target: Path,
     options: dict[str, str],
+    row_group_size: Optional[int] = None,
 ) -> None:
-    """Write parquet files to the target directory. This also updates the path attribute of the parquet files."""
+    """Write parquet files to the target directory. This also updates the path attribute of the parquet files.
+
+    The rows are sorted by the columns given in SORT_COLUMNS. The sort columns are stored as the key-value metadata
+    'sorted_by' so that readers can detect and rely on the ordering.
+    """
     for parquet_file in parquet_and_csv_files.values():
         parquet_file.path = path_target / f"{parquet_file.name}_v{parquet_file.version}.parquet"
+        sort_columns = get_sort_columns(connection, parquet_file.name)
+        all_options = {
+            **options,
+            "ROW_GROUP_SIZE": str(get_row_group_size(parquet_file.name, row_group_size)),
+            "KV_METADATA": f"{{sorted_by: '{','.join(sort_columns)}'}}",
+        }
+        order_by = f" ORDER BY {', '.join(sort_columns)}" if sort_columns else ""
         copy_cmd = (
-            f"COPY {parquet_file.name} TO '{parquet_file.path}' "
-            f"(FORMAT PARQUET, {', '.join(f'{k} {v}' for k, v in options.items())})"
+            f"COPY (SELECT * FROM {parquet_file.name}{order_by}) TO '{parquet_file.path}' "
+            f"(FORMAT PARQUET, {', '.join(f'{k} {v}' for k, v in all_options.items())})"
         )
         connection.execute(copy_cmd)
-        logging.debug(f"Wrote parquet file: {parquet_file.path}")
+        logging.debug(f"Wrote parquet file sorted by {sort_columns}: {parquet_file.path}")
 
 
 def print_metadata(connection: duckdb.DuckDBPyConnection, parquet_files: dict[str, TableFile]) -> None:
     """Print metadata for the given parquet files as a table."""
-    headers = ["Name", "Compression", "Rows", "Groups", "Rows/Group", "Size"]
+    headers = ["Name", "Compression", "Rows", "Groups", "Rows/Group", "Sorted by", "Size"]
 
     # Initialize a list to hold each row's data
     table_data = []
@@ -98,6 +141,10 @@ def print_metadata(connection: duckdb.DuckDBPyConnection, parquet_files: dict[st
             f"SELECT num_rows, num_row_groups FROM parquet_file_metadata('{parquet_file.path}')"
         ).fetchone()
 
+        sorted_by = connection.execute(
+            f"SELECT decode(value) FROM parquet_kv_metadata('{parquet_file.path}') WHERE decode(key) = 'sorted_by'"
+        ).fetchone()
+
         compression = metadata[0] if metadata else "Unknown"
         num_rows = file_metadata[0] / 1e3 if file_metadata else 0  # Convert to thousands
         num_row_groups = file_metadata[1] if file_metadata else 0
@@ -112,6 +159,7 @@ def print_metadata(connection: duckdb.DuckDBPyConnection, parquet_files: dict[st
                 f"{num_rows:5.0f} k",
                 f"{num_row_groups:6d}",
                 f"{num_rows_per_row_group:8.0f} k",
+                sorted_by[0] if sorted_by and sorted_by[0] else "-",
                 f"{size_on_disk:7.2f} MB",
             ]
         )
@@ -153,10 +201,17 @@ def optimize() -> None:
         default="ZSTD",
         help="The algorithm for compressing the parquet files.",
     )
+    parser.add_argument(
+        "--row_group_size",
+        type=int,
+        default=None,
+        help="The number of rows per row group. By default, a size depending on the kind of the table is used.",
+    )
     args = parser.parse_args()
 
     path_target = args.out
     compression = args.compression
+    row_group_size = args.row_group_size
 
     path_source = get_source_directory()
     parquet_and_csv_files = load_parquet_and_csv_files(path_source)
@@ -178,7 +233,7 @@ def optimize() -> None:
 
         # Write optimized parquet files
         write_parquet_files(
-            connection, parquet_and_csv_files, path_target, {"COMPRESSION": compression, "ROW_GROUP_SIZE": "100_000"}
+            connection, parquet_and_csv_files, path_target, {"COMPRESSION": compression}, row_group_size
         )
 
         # Print metadata of the new parquet files
@@ -207,6 +262,12 @@ def shrink() -> None:
         default="ZSTD",
         help="The algorithm for compressing the parquet files.",
     )
+    parser.add_argument(
+        "--row_group_size",
+        type=int,
+        default=None,
+        help="The number of rows per row group. By default, a size depending on the kind of the table is used.",
+    )
     parser.add_argument("--min_n", type=int, default=50, help="The minimum value for the quantum number n.")
     parser.add_argument("--max_n", type=int, default=70, help="The maximum value for the quantum number n.")
     parser.add_argument("--max_f", type=int, default=5, help="The maximum value for the quantum number f.")
@@ -214,6 +275,7 @@ def shrink() -> None:
 
     path_target = args.out
     compression = args.compression
+    row_group_size = args.row_group_size
     min_n = args.min_n
     max_n = args.max_n
     max_f = args.max_f
@@ -278,9 +340,7 @@ def shrink() -> None:
         delete_old_parquet_and_csv_files(path_target, parquet_files)
 
         # Write shrunk parquet files with compression
-        write_parquet_files(
-            connection, parquet_files, path_target, {"COMPRESSION": compression, "ROW_GROUP_SIZE": "100_000"}
-        )
+        write_parquet_files(connection, parquet_files, path_target, {"COMPRESSION": compression}, row_group_size)
 
         # Print metadata of the new parquet files
         logging.info("Metadata of the newly created parquet files")